@@ -9,6 +9,7 @@
 
 #include <string>
 #include "soa.h"
+#include "productindexedstore.h"
 #include "marketdataservice.h"
 #include "executionservice.h"
 
@@ -42,6 +43,9 @@ public:
     ExecutionOrder<Bond> GetExecutionOrder() const;
 };
 
+// Get the product id of an AlgoExecution, which decides its shard or its conflation slot on an edge
+std::string ProductKey(const AlgoExecution &data);
+
 
 /**
  * AlgoExecutionService is aimed to pick up the best orders from each orderbook in Market data and pass it to the ExecutionService
@@ -55,8 +59,8 @@ private:
     //define listener
     std::vector<ServiceListener<AlgoExecution>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, AlgoExecution> algo_execution_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<AlgoExecution> algo_execution_data;
 
     //ctor
     AlgoExecutionService(){};
@@ -87,6 +91,9 @@ public:
     // Add an orderbook to the service
     void AddOrderBook(OrderBook<Bond>& ob);
 
+    // Choose the execution for the orderbook without notifying listeners, return the updated algo execution
+    AlgoExecution& ApplyOrderBook(OrderBook<Bond>& ob);
+
 };
 
 
@@ -165,7 +172,7 @@ AlgoExecution::AlgoExecution(OrderBook<Bond> &ob)
     }
 
     //price and visible quantity
-    double price=0.;
+    TickPrice price;
     long vq=1000000;
 
     auto ask = ob.GetOfferStack().begin();
@@ -237,7 +244,7 @@ void AlgoExecution::OrderChoosing(const OrderBook<Bond>& ob)
         }
 
         //price and visible quantity
-        double price=0.;
+        TickPrice price;
         long vq= (1+rand()%2)*1000000;
         if(side==BID){
             //using the same of we define GetBestBidOffer, we choose bid or offer has minimum spread
@@ -245,7 +252,7 @@ void AlgoExecution::OrderChoosing(const OrderBook<Bond>& ob)
 
             //using loop to find the bid and offer with minimum spread: 1/128
             for(int i=0;i<ob.GetBidStack().size();i++){
-                if(ob.GetOfferStack()[i].GetPrice()-ob.GetBidStack()[i].GetPrice()==1/128.){
+                if(ob.GetOfferStack()[i].GetPrice()-ob.GetBidStack()[i].GetPrice()==MINIMUM_SPREAD){
                     index=i;
                 }
             }
@@ -260,7 +267,7 @@ void AlgoExecution::OrderChoosing(const OrderBook<Bond>& ob)
 
             //using loop to find the bid and offer with minimum spread: 1/128
             for(int i=0;i<ob.GetBidStack().size();i++){
-                if(ob.GetOfferStack()[i].GetPrice()-ob.GetBidStack()[i].GetPrice()==1/128.){
+                if(ob.GetOfferStack()[i].GetPrice()-ob.GetBidStack()[i].GetPrice()==MINIMUM_SPREAD){
                     index=i;
                 }
             }
@@ -294,34 +301,46 @@ ExecutionOrder<Bond> AlgoExecution::GetExecutionOrder() const
 
 
 
+std::string ProductKey(const AlgoExecution &data)
+{
+    return data.GetExecutionOrder().GetProduct().GetProductId();
+}
+
+
+
 //define member functions in class: AlgoExecutionService
-void AlgoExecutionService::AddOrderBook(OrderBook<Bond>& od)
+AlgoExecution& AlgoExecutionService::ApplyOrderBook(OrderBook<Bond>& od)
 {
-    //firstly, making the orderbook stored
-    std::string productId=od.GetProduct().GetProductId();
+    ProductId productId=od.GetProduct().GetId();
 
     //store the order
-    if(algo_execution_data.find(productId)!=algo_execution_data.end()){
+    AlgoExecution* algo=algo_execution_data.Find(productId);
+    if(algo){
         //if we can find the key of algo_execution_data, then just choose the order which has smallest spread
-        algo_execution_data[productId].OrderChoosing(od);
-    }
-    else{
-        //make a new pair
-        AlgoExecution new_algo(od);
-        algo_execution_data.insert(std::make_pair(productId,new_algo));
+        algo->OrderChoosing(od);
+        return *algo;
     }
 
+    //make a new pair
+    AlgoExecution new_algo(od);
+    return *algo_execution_data.Insert(productId,new_algo).first;
+}
+
+void AlgoExecutionService::AddOrderBook(OrderBook<Bond>& od)
+{
+    //firstly, making the orderbook stored, the execution after it is snapshotted once and shared by every listener
+    Snapshot<AlgoExecution> ae(ApplyOrderBook(od));
+
     //pass the execution data to listeners
-    std::cout<<"data goes from AlgoExecutionService -> listener."<<std::endl;
-    AlgoExecution ae=algo_execution_data[productId];
+    LOG_TRACE("data goes from AlgoExecutionService -> listener.");
     for(auto& l: listeners){
-        l->ProcessAdd(ae);
+        l->ProcessAddSnapshot(ae);
     }
 }
 
 AlgoExecution& AlgoExecutionService::GetData(std::string key)
 {
-    return algo_execution_data.at(key);
+    return algo_execution_data.At(key);
 }
 
 void AlgoExecutionService::OnMessage(AlgoExecution &data)
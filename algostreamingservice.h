@@ -9,6 +9,7 @@
 #include "streamingservice.h"
 #include "products.h"
 #include "pricingservice.h"
+#include "productindexedstore.h"
 
 
 class AlgoStream{
@@ -36,6 +37,9 @@ public:
     PriceStream<Bond> GetPriceStream() const;
 };
 
+// Get the product id of an AlgoStream, which decides its shard or its conflation slot on an edge
+std::string ProductKey(const AlgoStream &data);
+
 /**
  * AlgoStreamingService is aimed to send the bid/offer prices to the BondStreamingService
  * We use type Bond instead of using template T
@@ -48,8 +52,8 @@ private:
     //define listener
     std::vector<ServiceListener<AlgoStream>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, AlgoStream> algo_stream_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<AlgoStream> algo_stream_data;
 
     //ctor
     AlgoStreamingService(){};
@@ -131,7 +135,7 @@ AlgoStream::AlgoStream(const Price<Bond>& pri)
 {
     //we need to create the input parameters for pricestream
     //pricestreamorder: bid
-    double bid=pri.GetMid()-pri.GetBidOfferSpread()/2.; //bid price
+    TickPrice bid=pri.GetMid()-pri.GetBidOfferSpread()/2; //bid price, rounded down to a tick
     //visible_quantity
     long bid_vq=1000000; //initialize
     //hidden_quantity
@@ -139,7 +143,7 @@ AlgoStream::AlgoStream(const Price<Bond>& pri)
     PriceStreamOrder pso_bid(bid,bid_vq,bid_hq,BID);
 
     //pricestreamorder: OFFER
-    double offer=pri.GetMid()+pri.GetBidOfferSpread()/2.; //offer price
+    TickPrice offer=bid+pri.GetBidOfferSpread(); //offer price, a whole spread above bid
     //visible_quantity
     long offer_vq=1000000; //initialize
     //hidden_quantity
@@ -158,7 +162,7 @@ void AlgoStream::PriceChoosing(const Price<Bond>& pri)
 {
     //Actually, There is no specific algorithm to choose price, since we just need to send the bid/offer prices to the BondStreamingService
     //pricestreamorder: bid
-    double bid=pri.GetMid()-pri.GetBidOfferSpread()/2.; //bid price
+    TickPrice bid=pri.GetMid()-pri.GetBidOfferSpread()/2; //bid price, rounded down to a tick
     //visible_quantity
     long bid_vq=(1+rand()%2)*1000000; //changing quantity of both visible and hidden to get some change
     //hidden_quantity
@@ -166,7 +170,7 @@ void AlgoStream::PriceChoosing(const Price<Bond>& pri)
     PriceStreamOrder pso_bid(bid,bid_vq,bid_hq,BID);
 
     //pricestreamorder: OFFER
-    double offer=pri.GetMid()+pri.GetBidOfferSpread()/2.; //offer price
+    TickPrice offer=bid+pri.GetBidOfferSpread(); //offer price, a whole spread above bid
     //visible_quantity
     long offer_vq=(1+rand()%2)*1000000;
     //hidden_quantity
@@ -188,10 +192,17 @@ PriceStream<Bond> AlgoStream::GetPriceStream() const
 
 
 
+std::string ProductKey(const AlgoStream &data)
+{
+    return data.GetPriceStream().GetProduct().GetProductId();
+}
+
+
+
 //define member functions in class: AlgoStreamingService
 AlgoStream& AlgoStreamingService::GetData(std::string key)
 {
-    return algo_stream_data.at(key);
+    return algo_stream_data.At(key);
 }
 
 void AlgoStreamingService::OnMessage(AlgoStream &data)
@@ -213,22 +224,23 @@ const std::vector< ServiceListener<AlgoStream>* >& AlgoStreamingService::GetList
 void AlgoStreamingService::AddPrice(Price<Bond>& ob)
 {
     //firstly, making the stream price stored
-    std::string productId=ob.GetProduct().GetProductId();
+    ProductId productId=ob.GetProduct().GetId();
 
     //store the order
-    if(algo_stream_data.find(productId)!=algo_stream_data.end()){
+    AlgoStream* algo=algo_stream_data.Find(productId);
+    if(algo){
         //if we can find the key of algo_stream_data, then just choose the order which has smallest spread
-        algo_stream_data[productId].PriceChoosing(ob);
+        algo->PriceChoosing(ob);
     }
     else{
         //make a new pair
         AlgoStream new_algo(ob);
-        algo_stream_data.insert(std::make_pair(productId,new_algo));
+        algo=algo_stream_data.Insert(productId,new_algo).first;
     }
 
     //pass the algo streaming data to listeners
-    std::cout<<"data goes from AlgoStreamingService -> listener."<<std::endl;
-    AlgoStream as=algo_stream_data[productId];
+    LOG_TRACE("data goes from AlgoStreamingService -> listener.");
+    AlgoStream as=*algo;
     for(auto& l: listeners){
         l->ProcessAdd(as);
     }
@@ -0,0 +1,388 @@
+/**
+ * asynclistener.hpp
+ * Defines a ServiceListener that runs the service behind another listener on its own thread,
+ * through a bounded queue whose overflow policy says what happens when that thread falls behind (edgequeue.h).
+ *
+ * Registering AsyncListener<V>(PositionServiceListener::Generate_Instance()) on TradeBookingService instead of
+ * the PositionServiceListener itself makes TradeBookingService only queue a Snapshot of each trade; a worker
+ * thread takes the snapshots out in batches and hands them to PositionServiceListener, so PositionService and
+ * everything it notifies inline run on that thread. Each stage of a path can be wrapped the same way.
+ * A service that already fans out a Snapshot has it queued as it is, without copying the event.
+ *
+ * Every queue has exactly one producer, the thread of the service the AsyncListener is registered on.
+ *
+ * ShardedListener<V> spreads the same work over several threads: each product is hashed to one of N
+ * AsyncListeners, so a product's events stay in order on one thread while different products run in parallel.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef ASYNC_LISTENER_HPP
+#define ASYNC_LISTENER_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include "soa.h"
+#include "edgequeue.h"
+#include "cachealigned.h"
+
+using namespace std;
+
+/**
+ * An edge running on its own thread, whatever type of event goes through it.
+ * Stages hold the cache-line aligned indexes of their queues and are made with new, so they are CacheAligned.
+ */
+class AsyncStage : public CacheAligned
+{
+
+public:
+
+    virtual ~AsyncStage() {}
+
+    // Start the worker thread
+    virtual void Start() = 0;
+
+    // Wait until everything queued has been passed on, then stop the worker thread
+    virtual void Stop() = 0;
+
+    // Get the metrics of the queue
+    virtual EdgeMetrics GetMetrics() const = 0;
+
+};
+
+/**
+ * A ServiceListener that queues snapshots of what it is given and passes them on to target from a worker thread.
+ * Events reach target in order, in batches of up to batchSize through ProcessAddSnapshotBatch.
+ * Start must be called before the first event; Stop waits until everything queued has been passed on,
+ * so when several stages are wrapped they should be stopped from the first stage of the path to the last.
+ * With DROP_OLDEST or CONFLATE_BY_KEY the producer never waits, and target may not see every event.
+ */
+template<typename V>
+class AsyncListener : public ServiceListener<V>, public AsyncStage
+{
+
+public:
+
+    // ctor for a listener running target on its own thread
+    AsyncListener(ServiceListener<V> *_target, size_t capacity = ASYNC_QUEUE_DEFAULT_CAPACITY, size_t _batchSize = DEFAULT_BATCH_SIZE,
+                  OverflowPolicy policy = BLOCK_PRODUCER);
+
+    // dtor stops the worker
+    ~AsyncListener();
+
+    // Start the worker thread
+    void Start();
+
+    // Wait until everything queued has been passed on, then stop the worker thread
+    void Stop();
+
+    // Wait until everything queued so far has been passed on, the worker keeps running
+    void Flush();
+
+    // Listener callback to process an add event to the Service, with BLOCK_PRODUCER it waits while the queue is full
+    void ProcessAdd(V &data);
+
+    // Listener callback to process a remove event to the Service
+    void ProcessRemove(V &data);
+
+    // Listener callback to process an update event to the Service
+    void ProcessUpdate(V &data);
+
+    // Listener callback to process a batch of add events to the Service
+    void ProcessAddBatch(V *data, size_t count);
+
+    // Listener callback to process an add event shared as a snapshot, the handle is queued as it is
+    void ProcessAddSnapshot(const Snapshot<V> &data);
+
+    // Listener callback to process a batch of add events shared as snapshots
+    void ProcessAddSnapshotBatch(const Snapshot<V> *data, size_t count);
+
+    // Get the number of times the producer found the queue full and had to wait
+    long GetFullCount() const;
+
+    // Get the metrics of the queue
+    EdgeMetrics GetMetrics() const;
+
+private:
+
+    // a listener with a thread cannot be copied
+    AsyncListener(const AsyncListener &) = delete;
+    AsyncListener& operator=(const AsyncListener &) = delete;
+
+    // Body of the worker thread
+    void Run();
+
+    // Queue a snapshot as the overflow policy says
+    void Enqueue(const Snapshot<V> &data);
+
+    ServiceListener<V>* target;
+    EdgeQueue<V> queue;
+    size_t batchSize;
+    std::thread worker;
+    std::atomic<bool> running;
+    uint64_t queued;                // events that will be passed on, written by the producer only
+    std::atomic<uint64_t> passed;   // events passed on to target, written by the worker only
+
+};
+
+/**
+ * A ServiceListener that hashes the product of every event to one of several AsyncListeners, all passing on to target.
+ * The events of one product always go through the same worker thread, so they reach target in order.
+ * target, and everything it notifies inline, must be safe to call from several threads for different products.
+ * Cross-product results such as RiskService::GetBucketedRisk are only complete for the events queued so far
+ * once Flush has returned.
+ */
+template<typename V>
+class ShardedListener : public ServiceListener<V>
+{
+
+public:
+
+    // ctor for a listener running target on shards worker threads
+    ShardedListener(ServiceListener<V> *target, size_t shards, size_t capacity = ASYNC_QUEUE_DEFAULT_CAPACITY, size_t batchSize = DEFAULT_BATCH_SIZE,
+                    OverflowPolicy policy = BLOCK_PRODUCER);
+
+    // Start every worker thread
+    void Start();
+
+    // Wait until everything queued has been passed on, then stop every worker thread
+    void Stop();
+
+    // Wait until everything queued so far has been passed on by every shard
+    void Flush();
+
+    // Get the number of shards
+    size_t GetShardCount() const;
+
+    // Get the shard the product goes to
+    size_t GetShard(const std::string &productId) const;
+
+    // Listener callback to process an add event to the Service
+    void ProcessAdd(V &data);
+
+    // Listener callback to process a remove event to the Service
+    void ProcessRemove(V &data);
+
+    // Listener callback to process an update event to the Service
+    void ProcessUpdate(V &data);
+
+    // Listener callback to process an add event shared as a snapshot
+    void ProcessAddSnapshot(const Snapshot<V> &data);
+
+private:
+
+    std::vector<std::unique_ptr<AsyncListener<V>>> shards;
+    std::hash<std::string> hasher;
+
+};
+
+
+
+//define member functions in class: AsyncListener
+template<typename V>
+AsyncListener<V>::AsyncListener(ServiceListener<V> *_target, size_t capacity, size_t _batchSize, OverflowPolicy policy) :
+        target(_target), queue(capacity, policy), batchSize(_batchSize > 0 ? _batchSize : 1), running(false),
+        queued(0), passed(0)
+{
+}
+
+template<typename V>
+AsyncListener<V>::~AsyncListener()
+{
+    Stop();
+}
+
+template<typename V>
+void AsyncListener<V>::Start()
+{
+    if (running) return;
+    running = true;
+    worker = std::thread(&AsyncListener<V>::Run, this);
+}
+
+template<typename V>
+void AsyncListener<V>::Stop()
+{
+    if (!running) return;
+    running = false;
+    worker.join();
+}
+
+template<typename V>
+void AsyncListener<V>::Flush()
+{
+    while (passed.load(std::memory_order_acquire) < queued) {
+        std::this_thread::yield();
+    }
+}
+
+template<typename V>
+void AsyncListener<V>::Run()
+{
+    std::vector<Snapshot<V>> batch;
+    batch.reserve(batchSize);
+    Snapshot<V> item;
+    int idle = 0;
+
+    //keep going until Stop is called and the queue is empty
+    while (true) {
+        batch.clear();
+        while (batch.size() < batchSize && queue.TryPop(item)) {
+            batch.push_back(std::move(item));
+        }
+
+        if (!batch.empty()) {
+            target->ProcessAddSnapshotBatch(batch.data(), batch.size());
+            passed.fetch_add(batch.size(), std::memory_order_release);
+            idle = 0;
+            continue;
+        }
+
+        if (!running && queue.IsEmpty()) break;
+
+        //yield first so a busy producer is picked up at once, then back off to keep idle stages cheap
+        if (++idle < 1000) {
+            std::this_thread::yield();
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+template<typename V>
+void AsyncListener<V>::Enqueue(const Snapshot<V> &data)
+{
+    //an event that replaced or pushed out another one adds nothing to what Flush waits for
+    queued += queue.Push(data);
+}
+
+template<typename V>
+void AsyncListener<V>::ProcessAdd(V &data)
+{
+    Enqueue(Snapshot<V>(data));
+}
+
+template<typename V>
+void AsyncListener<V>::ProcessRemove(V &data)
+{
+    // no implementation
+}
+
+template<typename V>
+void AsyncListener<V>::ProcessUpdate(V &data)
+{
+    // no implementation
+}
+
+template<typename V>
+void AsyncListener<V>::ProcessAddBatch(V *data, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        ProcessAdd(data[i]);
+    }
+}
+
+template<typename V>
+void AsyncListener<V>::ProcessAddSnapshot(const Snapshot<V> &data)
+{
+    Enqueue(data);
+}
+
+template<typename V>
+void AsyncListener<V>::ProcessAddSnapshotBatch(const Snapshot<V> *data, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        Enqueue(data[i]);
+    }
+}
+
+template<typename V>
+long AsyncListener<V>::GetFullCount() const
+{
+    return static_cast<long>(queue.GetMetrics().blocked);
+}
+
+template<typename V>
+EdgeMetrics AsyncListener<V>::GetMetrics() const
+{
+    return queue.GetMetrics();
+}
+
+
+
+//define member functions in class: ShardedListener
+template<typename V>
+ShardedListener<V>::ShardedListener(ServiceListener<V> *target, size_t shardCount, size_t capacity, size_t batchSize, OverflowPolicy policy)
+{
+    for (size_t i = 0; i < (shardCount > 0 ? shardCount : 1); ++i) {
+        shards.push_back(std::unique_ptr<AsyncListener<V>>(new AsyncListener<V>(target, capacity, batchSize, policy)));
+    }
+}
+
+template<typename V>
+void ShardedListener<V>::Start()
+{
+    for (auto& shard : shards) {
+        shard->Start();
+    }
+}
+
+template<typename V>
+void ShardedListener<V>::Stop()
+{
+    for (auto& shard : shards) {
+        shard->Stop();
+    }
+}
+
+template<typename V>
+void ShardedListener<V>::Flush()
+{
+    for (auto& shard : shards) {
+        shard->Flush();
+    }
+}
+
+template<typename V>
+size_t ShardedListener<V>::GetShardCount() const
+{
+    return shards.size();
+}
+
+template<typename V>
+size_t ShardedListener<V>::GetShard(const std::string &productId) const
+{
+    return hasher(productId) % shards.size();
+}
+
+template<typename V>
+void ShardedListener<V>::ProcessAdd(V &data)
+{
+    shards[GetShard(ProductKey(data))]->ProcessAdd(data);
+}
+
+template<typename V>
+void ShardedListener<V>::ProcessAddSnapshot(const Snapshot<V> &data)
+{
+    shards[GetShard(ProductKey(*data))]->ProcessAddSnapshot(data);
+}
+
+template<typename V>
+void ShardedListener<V>::ProcessRemove(V &data)
+{
+    // no implementation
+}
+
+template<typename V>
+void ShardedListener<V>::ProcessUpdate(V &data)
+{
+    // no implementation
+}
+
+#endif
@@ -0,0 +1,326 @@
+/**
+ * binaryformat.hpp
+ * Defines the binary columnar format for prices and market data, and the converter from the csv files.
+ *
+ * A file is laid out as:
+ *   BinaryFileHeader
+ *   columnCount offsets (uint64) of each column from the start of the file
+ *   the columns, each holding rowCount fixed-width values and starting on an 8 byte boundary
+ *   the product table, productCount CUSIPs of PRODUCT_ID_WIDTH bytes padded with '\0'
+ * Column 0 is always the product index into the product table, prices are 1/256 ticks.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef BINARY_FORMAT_HPP
+#define BINARY_FORMAT_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "csvreader.h"
+#include "pricetick.h"
+
+using namespace std;
+
+// The record types a binary file can hold
+enum BinaryRecordType { PRICE_RECORDS = 1, MARKET_DATA_RECORDS = 2 };
+
+// Columns of a PRICE_RECORDS file
+enum PriceColumn { PRICE_PRODUCT = 0, PRICE_MID = 1, PRICE_SPREAD = 2, PRICE_COLUMN_COUNT = 3 };
+
+// Columns of a MARKET_DATA_RECORDS file, each price and quantity column is followed by the other levels
+const int BOOK_DEPTH = 5;
+enum MarketDataColumn {
+    MD_PRODUCT = 0,
+    MD_BID_PRICE = 1,
+    MD_BID_QUANTITY = MD_BID_PRICE + BOOK_DEPTH,
+    MD_OFFER_PRICE = MD_BID_QUANTITY + BOOK_DEPTH,
+    MD_OFFER_QUANTITY = MD_OFFER_PRICE + BOOK_DEPTH,
+    MD_COLUMN_COUNT = MD_OFFER_QUANTITY + BOOK_DEPTH
+};
+
+const char BINARY_MAGIC[8] = {'T', 'S', 'C', 'O', 'L', 'B', 'I', 'N'};
+const uint32_t BINARY_VERSION = 1;
+const size_t PRODUCT_ID_WIDTH = 16;
+
+/**
+ * Fixed header at the start of every binary file.
+ */
+struct BinaryFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordType;
+    uint64_t rowCount;
+    uint64_t productTableOffset;
+    uint32_t productCount;
+    uint32_t columnCount;
+};
+
+/**
+ * A binary columnar file mapped into memory.
+ * Columns are read in place, nothing is copied out of the mapping.
+ */
+class BinaryColumnFile
+{
+
+public:
+
+    // ctor maps and validates the file
+    explicit BinaryColumnFile(const std::string &path);
+
+    // Whether the file was mapped and every column and the product table lie inside it
+    bool IsValid() const;
+
+    // Get the record type held in the file
+    BinaryRecordType GetRecordType() const;
+
+    // Get the number of rows
+    size_t GetRowCount() const;
+
+    // Get the number of products in the product table
+    size_t GetProductCount() const;
+
+    // Get the product identifier for a product index
+    std::string GetProductId(size_t index) const;
+
+    // Get the product index column
+    const uint32_t* GetProductColumn() const;
+
+    // Get a tick or quantity column
+    const int64_t* GetColumn(size_t column) const;
+
+private:
+    MappedFile file;
+    const BinaryFileHeader* header;
+    const uint64_t* offsets;
+
+};
+
+// Get the number of columns a file of the given record type holds, 0 for an unknown type
+size_t GetColumnCount(BinaryRecordType recordType);
+
+// Whether count values of width bytes starting at offset lie inside a file of fileSize bytes, without overflowing
+bool FitsInFile(uint64_t offset, uint64_t count, uint64_t width, uint64_t fileSize);
+
+// Convert a csv file of the given record type to the binary format, return the number of rows written
+// Malformed lines are left out and counted in stats when it is given
+size_t ConvertCsvToBinary(const std::string &csvPath, const std::string &binaryPath, BinaryRecordType recordType, ParseStats *stats = nullptr);
+
+
+
+//define member functions in class: BinaryColumnFile
+BinaryColumnFile::BinaryColumnFile(const std::string &path) :
+        file(path), header(nullptr), offsets(nullptr)
+{
+    if (file.Size() < sizeof(BinaryFileHeader)) return;
+
+    const BinaryFileHeader* h = reinterpret_cast<const BinaryFileHeader*>(file.Begin());
+    if (memcmp(h->magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 || h->version != BINARY_VERSION) return;
+
+    //the record type fixes the columns, so every column GetColumn is asked for has an offset
+    size_t columnCount = GetColumnCount(static_cast<BinaryRecordType>(h->recordType));
+    if (columnCount == 0 || h->columnCount != columnCount) return;
+
+    //the column offsets and the product table must lie inside the file
+    if (!FitsInFile(sizeof(BinaryFileHeader), h->columnCount, sizeof(uint64_t), file.Size())) return;
+    if (!FitsInFile(h->productTableOffset, h->productCount, PRODUCT_ID_WIDTH, file.Size())) return;
+
+    //and so must every column, each aligned for the values it holds
+    const uint64_t* o = reinterpret_cast<const uint64_t*>(file.Begin() + sizeof(BinaryFileHeader));
+    for (size_t c = 0; c < columnCount; ++c) {
+        uint64_t width = (c == 0) ? sizeof(uint32_t) : sizeof(int64_t);
+        if (o[c] % width != 0 || !FitsInFile(o[c], h->rowCount, width, file.Size())) return;
+    }
+
+    header = h;
+    offsets = o;
+}
+
+bool BinaryColumnFile::IsValid() const
+{
+    return header != nullptr;
+}
+
+BinaryRecordType BinaryColumnFile::GetRecordType() const
+{
+    return static_cast<BinaryRecordType>(header->recordType);
+}
+
+size_t BinaryColumnFile::GetRowCount() const
+{
+    return header->rowCount;
+}
+
+size_t BinaryColumnFile::GetProductCount() const
+{
+    return header->productCount;
+}
+
+std::string BinaryColumnFile::GetProductId(size_t index) const
+{
+    const char* id = file.Begin() + header->productTableOffset + index * PRODUCT_ID_WIDTH;
+    return std::string(id, strnlen(id, PRODUCT_ID_WIDTH));
+}
+
+const uint32_t* BinaryColumnFile::GetProductColumn() const
+{
+    return reinterpret_cast<const uint32_t*>(file.Begin() + offsets[0]);
+}
+
+const int64_t* BinaryColumnFile::GetColumn(size_t column) const
+{
+    return reinterpret_cast<const int64_t*>(file.Begin() + offsets[column]);
+}
+
+
+
+size_t GetColumnCount(BinaryRecordType recordType)
+{
+    switch (recordType) {
+        case PRICE_RECORDS : return static_cast<size_t>(PRICE_COLUMN_COUNT);
+        case MARKET_DATA_RECORDS : return static_cast<size_t>(MD_COLUMN_COUNT);
+    }
+    return 0;
+}
+
+bool FitsInFile(uint64_t offset, uint64_t count, uint64_t width, uint64_t fileSize)
+{
+    if (offset > fileSize) return false;
+    return count <= (fileSize - offset) / width;
+}
+
+size_t ConvertCsvToBinary(const std::string &csvPath, const std::string &binaryPath, BinaryRecordType recordType, ParseStats *stats)
+{
+    MappedFile csv(csvPath);
+    if (!csv.IsOpen()) return 0;
+
+    //every line but the header can become a row, so size the columns on the line count
+    size_t capacity = 0;
+    for (const char* p = csv.Begin(); p < csv.End(); ++p) {
+        if (*p == '\n') ++capacity;
+    }
+    ++capacity;
+
+    size_t columnCount = GetColumnCount(recordType);
+    if (columnCount == 0) return 0;
+    size_t fieldCount = (recordType == PRICE_RECORDS) ? 3 : 1 + 4 * BOOK_DEPTH;
+
+    //lay out the columns one after the other, each aligned to 8 bytes
+    std::vector<uint64_t> offsets(columnCount);
+    uint64_t position = sizeof(BinaryFileHeader) + columnCount * sizeof(uint64_t);
+    for (size_t c = 0; c < columnCount; ++c) {
+        position = (position + 7) & ~static_cast<uint64_t>(7);
+        offsets[c] = position;
+        position += capacity * (c == 0 ? sizeof(uint32_t) : sizeof(int64_t));
+    }
+    uint64_t productTableOffset = (position + 7) & ~static_cast<uint64_t>(7);
+
+    int fd = open(binaryPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 0;
+    if (ftruncate(fd, productTableOffset) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    void* p = mmap(nullptr, productTableOffset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+    char* out = static_cast<char*>(p);
+
+    uint32_t* productColumn = reinterpret_cast<uint32_t*>(out + offsets[0]);
+    std::vector<int64_t*> columns(columnCount, nullptr);
+    for (size_t c = 1; c < columnCount; ++c) {
+        columns[c] = reinterpret_cast<int64_t*>(out + offsets[c]);
+    }
+
+    //product identifiers are numbered in order of first appearance
+    std::map<boost::string_view, uint32_t> productIndex;
+    std::vector<boost::string_view> products;
+
+    CsvLineReader reader(csv.Begin(), csv.End());
+    reader.NextLine(); //skip the header
+
+    boost::string_view fields[1 + 4 * BOOK_DEPTH];
+    size_t rows = 0;
+
+    while (reader.NextLine()) {
+        if (reader.GetLine().empty()) continue;
+
+        //parse the whole line into the next row before it is counted, a bad line is simply overwritten
+        ParseErrc ec = PARSE_OK;
+        if (reader.Split(fields, fieldCount) < fieldCount) {
+            ec = PARSE_MISSING_FIELDS;
+        }
+        else if (fields[0].empty()) {
+            ec = PARSE_EMPTY_FIELD;
+        }
+        else if (fields[0].size() > PRODUCT_ID_WIDTH) {
+            ec = PARSE_OUT_OF_RANGE;
+        }
+        else if (recordType == PRICE_RECORDS) {
+            ParseResult r = ParsePriceTicks(fields[1], columns[PRICE_MID][rows]);
+            if (r.ec == PARSE_OK) r = ParsePriceTicks(fields[2], columns[PRICE_SPREAD][rows]);
+            ec = r.ec;
+        }
+        else {
+            //the csv interleaves price and quantity, bids first then offers
+            for (int level = 0; level < BOOK_DEPTH && ec == PARSE_OK; ++level) {
+                long bidQuantity = 0, offerQuantity = 0;
+                ParseResult r = ParsePriceTicks(fields[2 * level + 1], columns[MD_BID_PRICE + level][rows]);
+                if (r.ec == PARSE_OK) r = ParseLong(fields[2 * level + 2], bidQuantity);
+                if (r.ec == PARSE_OK) r = ParsePriceTicks(fields[2 * (level + BOOK_DEPTH) + 1], columns[MD_OFFER_PRICE + level][rows]);
+                if (r.ec == PARSE_OK) r = ParseLong(fields[2 * (level + BOOK_DEPTH) + 2], offerQuantity);
+                columns[MD_BID_QUANTITY + level][rows] = bidQuantity;
+                columns[MD_OFFER_QUANTITY + level][rows] = offerQuantity;
+                ec = r.ec;
+            }
+        }
+
+        if (stats) stats->CountLine(ec);
+        if (ec != PARSE_OK) continue;
+
+        auto it = productIndex.find(fields[0]);
+        if (it == productIndex.end()) {
+            it = productIndex.insert(std::make_pair(fields[0], static_cast<uint32_t>(products.size()))).first;
+            products.push_back(fields[0]);
+        }
+        productColumn[rows] = it->second;
+        ++rows;
+    }
+
+    //write the header and the column offsets in front of the columns
+    BinaryFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.recordType = recordType;
+    header.rowCount = rows;
+    header.productTableOffset = productTableOffset;
+    header.productCount = static_cast<uint32_t>(products.size());
+    header.columnCount = static_cast<uint32_t>(columnCount);
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), offsets.data(), columnCount * sizeof(uint64_t));
+    munmap(p, productTableOffset);
+
+    //the product table goes at the end
+    std::vector<char> table(products.size() * PRODUCT_ID_WIDTH, '\0');
+    for (size_t i = 0; i < products.size(); ++i) {
+        memcpy(&table[i * PRODUCT_ID_WIDTH], products[i].data(), products[i].size());
+    }
+    bool written = table.empty() ||
+            pwrite(fd, table.data(), table.size(), productTableOffset) == static_cast<ssize_t>(table.size());
+    close(fd);
+
+    return written ? rows : 0;
+}
+
+#endif
@@ -8,6 +8,7 @@
 
 #include "executionservice.h"
 #include "algoexecutionservice.h"
+#include "productindexedstore.h"
 
 /**
  * Service for executing bond orders on an exchange.
@@ -21,8 +22,8 @@ private:
     //define listener
     std::vector<ServiceListener<ExecutionOrder<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, ExecutionOrder<Bond>> execution_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<ExecutionOrder<Bond>> execution_data;
 
     //ctor
     BondExecutionService(){};
@@ -53,6 +54,9 @@ public:
     // Add Algo Execution to the service
     void AddAlgoExecution(AlgoExecution& ob);
 
+    // Store the order of the algo execution without notifying listeners, return the stored order
+    ExecutionOrder<Bond>& ApplyAlgoExecution(AlgoExecution& ae);
+
     // Execute an order on a market
     void ExecuteOrder(const ExecutionOrder<Bond>& order, Market market);
 };
@@ -103,7 +107,7 @@ public:
 //define member functions in class: BondExecutionService
 ExecutionOrder<Bond>& BondExecutionService::GetData(std::string key)
 {
-    return execution_data.at(key);
+    return execution_data.At(key);
 }
 
 void BondExecutionService::OnMessage(ExecutionOrder<Bond> &data)
@@ -122,17 +126,21 @@ const std::vector< ServiceListener<ExecutionOrder<Bond>>* >& BondExecutionServic
 }
 
 // Add Algo Execution to the service
-void BondExecutionService::AddAlgoExecution(AlgoExecution& ae)
+ExecutionOrder<Bond>& BondExecutionService::ApplyAlgoExecution(AlgoExecution& ae)
 {
-    //firstly, making the AlgoExecution stored
-    std::string productID=ae.GetExecutionOrder().GetProduct().GetProductId();
+    const ExecutionOrder<Bond>& order=ae.GetExecutionOrder();
 
     //store the AlgoExecution
-    execution_data[productID]=ae.GetExecutionOrder();
+    return execution_data.Set(order.GetProduct().GetId(),order);
+}
+
+void BondExecutionService::AddAlgoExecution(AlgoExecution& ae)
+{
+    //firstly, making the AlgoExecution stored
+    ExecutionOrder<Bond> val=ApplyAlgoExecution(ae);
 
     //pass the execution data to listeners
-    std::cout<<"data goes from BondExecutionService -> listener."<<std::endl;
-    auto val=ae.GetExecutionOrder();
+    LOG_TRACE("data goes from BondExecutionService -> listener.");
     for(auto& l: listeners){
         l->ProcessAdd(val);
     }
@@ -141,14 +149,13 @@ void BondExecutionService::AddAlgoExecution(AlgoExecution& ae)
 void BondExecutionService::ExecuteOrder(const ExecutionOrder<Bond>& order, Market market)
 {
     //firstly, making the order stored
-    std::string productId=order.GetProduct().GetProductId();
+    ProductId productId=order.GetProduct().GetId();
 
     //store
     ExecutionOrder<Bond> new_exe(order);
-    execution_data.insert(std::make_pair(productId,new_exe));
 
     //pass the execution data to listeners
-    ExecutionOrder<Bond> eo=execution_data[productId];
+    ExecutionOrder<Bond> eo=*execution_data.Insert(productId,new_exe).first;
     for(auto& l: listeners){
         l->ProcessAdd(eo);
     }
@@ -9,6 +9,7 @@
 #include "streamingservice.h"
 #include "products.h"
 #include "algostreamingservice.h"
+#include "productindexedstore.h"
 
 
 /**
@@ -40,8 +41,8 @@ private:
     //define listener
     std::vector<ServiceListener<PriceStream<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, PriceStream<Bond>> stream_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<PriceStream<Bond>> stream_data;
 
     //ctor
     BondStreamingService(){};
@@ -122,7 +123,7 @@ public:
 //define member functions in class: BondStreamingService
 PriceStream<Bond>& BondStreamingService::GetData(std::string key)
 {
-    return stream_data.at(key);
+    return stream_data.At(key);
 }
 
 void BondStreamingService::OnMessage(PriceStream<Bond> &data)
@@ -143,37 +144,33 @@ const std::vector< ServiceListener<PriceStream<Bond>>* >& BondStreamingService::
 void BondStreamingService::AddAlgoStream(AlgoStream& ob)
 {
     //firstly, making the AlgoStream stored
-    std::string productID=ob.GetPriceStream().GetProduct().GetProductId();
+    const PriceStream<Bond>& stream=ob.GetPriceStream();
 
     //store the AlgoStream
-    stream_data[productID]=ob.GetPriceStream();
+    stream_data.Set(stream.GetProduct().GetId(),stream);
 
-    //pass the streaming data to listeners
-    std::cout<<"data goes from BondStreamingService -> listener."<<std::endl;
-    auto val=ob.GetPriceStream();
+    //pass the streaming data to listeners, snapshotted once and shared by every listener
+    LOG_TRACE("data goes from BondStreamingService -> listener.");
+    Snapshot<PriceStream<Bond>> val(ob.GetPriceStream());
     for(auto& l: listeners){
-        l->ProcessAdd(val);
+        l->ProcessAddSnapshot(val);
     }
 }
 
 void BondStreamingService::PublishPrice(const PriceStream<Bond>& priceStream)
 {
-    //get bid and offer price
-    double price_bid=priceStream.GetBidOrder().GetPrice();
-    double price_offer=priceStream.GetOfferOrder().GetPrice();
-
-    //Then, making the priceStream stored
-    std::string productID=priceStream.GetProduct().GetProductId();
+    //making the priceStream stored
+    ProductId productID=priceStream.GetProduct().GetId();
 
     //store the priceStream
     PriceStream<Bond> new_stream(priceStream);
-    stream_data.insert(std::make_pair(productID, new_stream));
+    const PriceStream<Bond>& stored=*stream_data.Insert(productID, new_stream).first;
 
     //pass the streaming data to listeners
-    std::cout<<"data goes from BondStreamingService -> listener."<<std::endl;
-    PriceStream<Bond> ps=stream_data[productID];
+    LOG_TRACE("data goes from BondStreamingService -> listener.");
+    Snapshot<PriceStream<Bond>> ps(stored);
     for(auto& l: listeners){
-        l->ProcessAdd(ps);
+        l->ProcessAddSnapshot(ps);
     }
 
 }
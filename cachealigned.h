@@ -0,0 +1,47 @@
+/**
+ * cachealigned.hpp
+ * Defines the base class for objects that are allocated with new and hold members aligned to a cache line.
+ *
+ * Under C++11 operator new only guarantees the alignment of std::max_align_t (16 bytes), not the
+ * alignas(64) of members such as the head and tail of an SpscQueue, so on the heap they could share a
+ * cache line after all. A class deriving from CacheAligned is allocated on a cache line boundary instead.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef CACHE_ALIGNED_HPP
+#define CACHE_ALIGNED_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+// Size of a cache line, the alignment the alignas(64) members ask for
+const size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * Base class giving a class an operator new that allocates on a cache line boundary.
+ */
+struct CacheAligned
+{
+    static void* operator new(size_t size);
+    static void operator delete(void *p);
+};
+
+
+
+//define member functions in class: CacheAligned
+void* CacheAligned::operator new(size_t size)
+{
+    void* p = nullptr;
+    if (posix_memalign(&p, CACHE_LINE_SIZE, size) != 0) throw std::bad_alloc();
+    return p;
+}
+
+void CacheAligned::operator delete(void *p)
+{
+    free(p);
+}
+
+#endif
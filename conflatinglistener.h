@@ -0,0 +1,317 @@
+/**
+ * conflatinglistener.hpp
+ * Defines a ServiceListener that only passes on the latest event of each product, on its own thread.
+ *
+ * PricingService and MarketDataService send many updates per CUSIP, while consumers such as BondGuiService,
+ * BondStreamingService or the historical writers only need the latest state of a product. Registering
+ * ConflatingListener<V>(BondGuiServiceListener::Generate_Instance()) instead of the listener keeps one slot
+ * per product: every update replaces the snapshot in its product's slot and marks the slot dirty, and a
+ * worker thread takes the latest snapshot out of each dirty slot and hands it on. An update arriving while
+ * its slot is still dirty costs no downstream work at all, so the consumer does work for products times
+ * the rate it drains at, not for every tick.
+ *
+ * Slot and dirty flag are atomics and the dirty slots are passed to the worker through a SpscQueue,
+ * so the producer and the worker never take a lock.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef CONFLATING_LISTENER_HPP
+#define CONFLATING_LISTENER_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include "soa.h"
+#include "spscqueue.h"
+#include "asynclistener.h"
+
+using namespace std;
+
+// Number of products a ConflatingListener has slots for by default
+const size_t CONFLATING_DEFAULT_SLOTS = 256;
+
+/**
+ * A ServiceListener passing the latest event of every product on to target from a worker thread.
+ * target gets events of different products in the order they became dirty, and of one product only the
+ * latest; it never sees an older event of a product after a newer one. The worker hands them on in batches
+ * of up to batchSize through ProcessAddSnapshotBatch, then waits interval before draining again, which bounds
+ * how often target sees a product. Updates for more products than there are slots are dropped and counted.
+ * Start must be called before the first event; Stop waits until every dirty product has been passed on.
+ */
+template<typename V>
+class ConflatingListener : public ServiceListener<V>, public AsyncStage
+{
+
+public:
+
+    // ctor for a listener running target on its own thread with room for slotCount products
+    ConflatingListener(ServiceListener<V> *_target, size_t slotCount = CONFLATING_DEFAULT_SLOTS, size_t _batchSize = DEFAULT_BATCH_SIZE,
+                       std::chrono::microseconds _interval = std::chrono::microseconds(0));
+
+    // dtor stops the worker
+    ~ConflatingListener();
+
+    // Start the worker thread
+    void Start();
+
+    // Wait until every dirty product has been passed on, then stop the worker thread
+    void Stop();
+
+    // Wait until every product dirty so far has been passed on, the worker keeps running
+    void Flush();
+
+    // Listener callback to process an add event to the Service
+    void ProcessAdd(V &data);
+
+    // Listener callback to process a remove event to the Service
+    void ProcessRemove(V &data);
+
+    // Listener callback to process an update event to the Service
+    void ProcessUpdate(V &data);
+
+    // Listener callback to process a batch of add events to the Service
+    void ProcessAddBatch(V *data, size_t count);
+
+    // Listener callback to process an add event shared as a snapshot, the handle is kept as it is
+    void ProcessAddSnapshot(const Snapshot<V> &data);
+
+    // Listener callback to process a batch of add events shared as snapshots
+    void ProcessAddSnapshotBatch(const Snapshot<V> *data, size_t count);
+
+    // Get the number of products that have a slot
+    size_t GetProductCount() const;
+
+    // Get the metrics of the listener: depth is the number of dirty products, conflated the updates replaced before being passed on
+    EdgeMetrics GetMetrics() const;
+
+private:
+
+    // the latest event of one product
+    struct Slot
+    {
+        std::atomic<Snapshot<V>*> latest;   // swapped in by the producer, taken out by the worker
+        std::atomic<bool> dirty;            // whether the slot is queued for the worker
+
+        Slot() : latest(nullptr), dirty(false) {}
+        ~Slot() { delete latest.load(); }
+    };
+
+    // a listener with a thread cannot be copied
+    ConflatingListener(const ConflatingListener &) = delete;
+    ConflatingListener& operator=(const ConflatingListener &) = delete;
+
+    // Body of the worker thread
+    void Run();
+
+    // Put a snapshot in the slot of its product (producer only)
+    void Store(const Snapshot<V> &data);
+
+    ServiceListener<V>* target;
+    size_t slotCount;
+    std::unique_ptr<Slot[]> slots;
+    std::unordered_map<std::string, size_t> slotOf;     // the slot of each product, producer only
+    SpscQueue<size_t> dirtySlots;                       // each slot is queued at most once while it is dirty
+    size_t batchSize;
+    std::chrono::microseconds interval;
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<size_t> productCount;   // written by the producer only
+    uint64_t marked;                    // slots queued, written by the producer only
+    std::atomic<uint64_t> drained;      // slots taken out of the queue, written by the worker only
+    std::atomic<uint64_t> pushed;       // written by the producer only
+    std::atomic<uint64_t> popped;       // written by the worker only
+    std::atomic<uint64_t> conflated;    // written by the producer only
+    std::atomic<uint64_t> dropped;      // written by the producer only
+
+};
+
+
+
+//define member functions in class: ConflatingListener
+template<typename V>
+ConflatingListener<V>::ConflatingListener(ServiceListener<V> *_target, size_t _slotCount, size_t _batchSize, std::chrono::microseconds _interval) :
+        target(_target), slotCount(_slotCount > 0 ? _slotCount : 1), slots(new Slot[slotCount]), dirtySlots(slotCount),
+        batchSize(_batchSize > 0 ? _batchSize : 1), interval(_interval), running(false), productCount(0),
+        marked(0), drained(0), pushed(0), popped(0), conflated(0), dropped(0)
+{
+}
+
+template<typename V>
+ConflatingListener<V>::~ConflatingListener()
+{
+    Stop();
+}
+
+template<typename V>
+void ConflatingListener<V>::Start()
+{
+    if (running) return;
+    running = true;
+    worker = std::thread(&ConflatingListener<V>::Run, this);
+}
+
+template<typename V>
+void ConflatingListener<V>::Stop()
+{
+    if (!running) return;
+    running = false;
+    worker.join();
+}
+
+template<typename V>
+void ConflatingListener<V>::Flush()
+{
+    while (drained.load(std::memory_order_acquire) < marked) {
+        std::this_thread::yield();
+    }
+}
+
+template<typename V>
+void ConflatingListener<V>::Store(const Snapshot<V> &data)
+{
+    pushed.store(pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    const std::string& key = ProductKey(*data);
+    auto it = slotOf.find(key);
+    if (it == slotOf.end()) {
+        if (slotOf.size() == slotCount) {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        it = slotOf.insert(std::make_pair(key, slotOf.size())).first;
+        productCount.store(slotOf.size(), std::memory_order_relaxed);
+    }
+
+    size_t index = it->second;
+    Slot& slot = slots[index];
+
+    //an event the worker has not taken yet is replaced and never passed on
+    Snapshot<V>* old = slot.latest.exchange(new Snapshot<V>(data), std::memory_order_acq_rel);
+    if (old) {
+        conflated.store(conflated.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        delete old;
+    }
+
+    //only a slot that is not queued yet is queued, so the queue never holds more than slotCount
+    if (!slot.dirty.exchange(true, std::memory_order_acq_rel)) {
+        dirtySlots.TryPush(index);
+        ++marked;
+    }
+}
+
+template<typename V>
+void ConflatingListener<V>::Run()
+{
+    std::vector<Snapshot<V>> batch;
+    batch.reserve(batchSize);
+    size_t index;
+    int idle = 0;
+
+    //keep going until Stop is called and no slot is dirty
+    while (true) {
+        batch.clear();
+        uint64_t taken = 0;
+        while (batch.size() < batchSize && dirtySlots.TryPop(index)) {
+            ++taken;
+            Slot& slot = slots[index];
+
+            //clear the flag before taking the event: an update landing after this queues the slot again
+            slot.dirty.store(false, std::memory_order_release);
+            Snapshot<V>* latest = slot.latest.exchange(nullptr, std::memory_order_acq_rel);
+
+            //the event may already have gone with an earlier batch, the slot was queued again just after
+            if (!latest) continue;
+            batch.push_back(std::move(*latest));
+            delete latest;
+        }
+
+        if (!batch.empty()) {
+            target->ProcessAddSnapshotBatch(batch.data(), batch.size());
+            popped.store(popped.load(std::memory_order_relaxed) + batch.size(), std::memory_order_relaxed);
+        }
+        if (taken > 0) {
+            drained.fetch_add(taken, std::memory_order_release);
+            idle = 0;
+            if (interval.count() > 0) std::this_thread::sleep_for(interval);
+            continue;
+        }
+
+        if (!running && dirtySlots.IsEmpty()) break;
+
+        //yield first so a busy producer is picked up at once, then back off to keep idle stages cheap
+        if (++idle < 1000) {
+            std::this_thread::yield();
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessAdd(V &data)
+{
+    Store(Snapshot<V>(data));
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessRemove(V &data)
+{
+    // no implementation
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessUpdate(V &data)
+{
+    // no implementation
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessAddBatch(V *data, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        ProcessAdd(data[i]);
+    }
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessAddSnapshot(const Snapshot<V> &data)
+{
+    Store(data);
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessAddSnapshotBatch(const Snapshot<V> *data, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        Store(data[i]);
+    }
+}
+
+template<typename V>
+size_t ConflatingListener<V>::GetProductCount() const
+{
+    return productCount.load(std::memory_order_relaxed);
+}
+
+template<typename V>
+EdgeMetrics ConflatingListener<V>::GetMetrics() const
+{
+    EdgeMetrics metrics;
+    metrics.capacity = slotCount;
+    metrics.depth = dirtySlots.GetDepth();
+    metrics.highWater = dirtySlots.GetHighWater();
+    metrics.pushed = pushed.load(std::memory_order_relaxed);
+    metrics.popped = popped.load(std::memory_order_relaxed);
+    metrics.dropped = dropped.load(std::memory_order_relaxed);
+    metrics.conflated = conflated.load(std::memory_order_relaxed);
+    metrics.blocked = 0;
+    return metrics;
+}
+
+#endif
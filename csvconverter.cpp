@@ -0,0 +1,53 @@
+/**
+ * csvconverter.cpp
+ * Converts prices.txt and marketdata.txt to the binary columnar format read by the connectors.
+ *
+ * Usage: csvconverter prices|marketdata [input.txt] [output.bin]
+ *
+ * @author Sijia Zhang
+ */
+#include <iostream>
+#include <string>
+#include "binaryformat.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]){
+    if(argc<2){
+        std::cout<<"Usage: "<<argv[0]<<" prices|marketdata [input.txt] [output.bin]"<<std::endl;
+        return 1;
+    }
+
+    //pick the record type and the default paths used by the connectors
+    std::string kind=argv[1];
+    BinaryRecordType type;
+    std::string input, output;
+    if(kind=="prices"){
+        type=PRICE_RECORDS;
+        input="../input/prices.txt";
+        output="../input/prices.bin";
+    }
+    else if(kind=="marketdata"){
+        type=MARKET_DATA_RECORDS;
+        input="../input/marketdata.txt";
+        output="../input/marketdata.bin";
+    }
+    else{
+        std::cout<<"Unknown input kind: "<<kind<<std::endl;
+        return 1;
+    }
+
+    if(argc>2) input=argv[2];
+    if(argc>3) output=argv[3];
+
+    ParseStats stats(input);
+    size_t rows=ConvertCsvToBinary(input, output, type, &stats);
+    std::cout<<stats<<std::endl;
+    if(rows==0){
+        std::cout<<"Nothing converted from "<<input<<std::endl;
+        return 1;
+    }
+
+    std::cout<<input<<" -> "<<output<<": "<<rows<<" rows"<<std::endl;
+    return 0;
+}
@@ -0,0 +1,254 @@
+/**
+ * csvreader.hpp
+ * Defines a memory-mapped reader for the comma separated input files.
+ * Lines and fields are handed out as string views pointing straight into the mapping,
+ * so scanning a file does not allocate per line.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef CSV_READER_HPP
+#define CSV_READER_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "boost/utility/string_view.hpp"
+#include "parsestats.h"
+
+using namespace std;
+
+/**
+ * A read-only memory mapping of a whole file.
+ * The mapping lives as long as the object, so views taken from it must not outlive it.
+ */
+class MappedFile
+{
+
+public:
+
+    // ctor maps the file at the given path
+    explicit MappedFile(const std::string &path);
+
+    // dtor unmaps the file
+    ~MappedFile();
+
+    // Whether the file was opened and mapped
+    bool IsOpen() const;
+
+    // Get the first byte of the file
+    const char* Begin() const;
+
+    // Get one past the last byte of the file
+    const char* End() const;
+
+    // Get the size of the file in bytes
+    size_t Size() const;
+
+private:
+
+    // a mapping cannot be copied
+    MappedFile(const MappedFile &) = delete;
+    MappedFile& operator=(const MappedFile &) = delete;
+
+    int fd;
+    const char* data;
+    size_t size;
+
+};
+
+/**
+ * CsvLineReader walks a range of bytes one line at a time and splits the current line on commas.
+ */
+class CsvLineReader
+{
+
+public:
+
+    // ctor for a reader over [begin, end)
+    CsvLineReader(const char *_begin, const char *_end);
+
+    // Move to the next line, return false once the range is exhausted
+    bool NextLine();
+
+    // Get the current line without its line terminator
+    boost::string_view GetLine() const;
+
+    // Split the current line into at most maxFields fields and return how many were found
+    size_t Split(boost::string_view *fields, size_t maxFields) const;
+
+private:
+    const char* cursor;
+    const char* end;
+    boost::string_view line;
+
+};
+
+// Parse a decimal integer out of a field without allocating, value is left untouched on error
+ParseResult ParseLong(boost::string_view s, long &value);
+
+// Split [begin, end) into at most parts chunks that each start at the beginning of a line
+std::vector<std::pair<const char*, const char*>> SplitAtLines(const char *begin, const char *end, size_t parts);
+
+
+
+//define member functions in class: MappedFile
+MappedFile::MappedFile(const std::string &path) : fd(-1), data(nullptr), size(0)
+{
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+
+    //an empty file is open but has nothing to map
+    size = static_cast<size_t>(st.st_size);
+    if (size == 0) return;
+
+    void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        fd = -1;
+        size = 0;
+        return;
+    }
+
+    //we read the file front to back, so let the kernel read ahead aggressively
+    madvise(p, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(p);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data) munmap(const_cast<char*>(data), size);
+    if (fd >= 0) close(fd);
+}
+
+bool MappedFile::IsOpen() const
+{
+    return fd >= 0;
+}
+
+const char* MappedFile::Begin() const
+{
+    return data;
+}
+
+const char* MappedFile::End() const
+{
+    return data + size;
+}
+
+size_t MappedFile::Size() const
+{
+    return size;
+}
+
+
+
+//define member functions in class: CsvLineReader
+CsvLineReader::CsvLineReader(const char *_begin, const char *_end) :
+        cursor(_begin), end(_end)
+{
+}
+
+bool CsvLineReader::NextLine()
+{
+    if (cursor >= end) return false;
+
+    //find the end of the current line
+    const char* eol = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+    const char* next = eol ? eol + 1 : end;
+    if (!eol) eol = end;
+
+    //drop a windows line terminator
+    if (eol > cursor && eol[-1] == '\r') --eol;
+
+    line = boost::string_view(cursor, eol - cursor);
+    cursor = next;
+    return true;
+}
+
+boost::string_view CsvLineReader::GetLine() const
+{
+    return line;
+}
+
+size_t CsvLineReader::Split(boost::string_view *fields, size_t maxFields) const
+{
+    size_t count = 0;
+    const char* p = line.data();
+    const char* last = line.data() + line.size();
+
+    while (count < maxFields) {
+        const char* comma = static_cast<const char*>(memchr(p, ',', last - p));
+        if (!comma) {
+            //the final field on the line, skip it when the line ends with a comma
+            if (p < last || count == 0) fields[count++] = boost::string_view(p, last - p);
+            break;
+        }
+        fields[count++] = boost::string_view(p, comma - p);
+        p = comma + 1;
+    }
+
+    return count;
+}
+
+
+
+ParseResult ParseLong(boost::string_view s, long &value)
+{
+    const char* p = s.data();
+    const char* last = s.data() + s.size();
+    if (p == last) return ParseResult{p, PARSE_EMPTY_FIELD};
+
+    bool negative = (*p == '-');
+    if (negative && ++p == last) return ParseResult{p, PARSE_INVALID_CHARACTER};
+
+    //accumulate as unsigned and check against the limit of the sign before every digit
+    unsigned long limit = negative ? static_cast<unsigned long>(LONG_MAX) + 1 : static_cast<unsigned long>(LONG_MAX);
+    unsigned long v = 0;
+    for (; p < last; ++p) {
+        unsigned d = static_cast<unsigned>(*p - '0');
+        if (d > 9) return ParseResult{p, PARSE_INVALID_CHARACTER};
+        if (v > (limit - d) / 10) return ParseResult{p, PARSE_OUT_OF_RANGE};
+        v = v * 10 + d;
+    }
+
+    value = negative ? static_cast<long>(0UL - v) : static_cast<long>(v);
+    return ParseResult{p, PARSE_OK};
+}
+
+std::vector<std::pair<const char*, const char*>> SplitAtLines(const char *begin, const char *end, size_t parts)
+{
+    std::vector<std::pair<const char*, const char*>> chunks;
+    if (parts == 0) parts = 1;
+
+    size_t target = (end - begin) / parts + 1;
+    const char* start = begin;
+
+    while (start < end) {
+        //move the cut forward to just after the next line terminator
+        const char* cut = (static_cast<size_t>(end - start) > target) ? start + target : end;
+        if (cut < end) {
+            const char* eol = static_cast<const char*>(memchr(cut, '\n', end - cut));
+            cut = eol ? eol + 1 : end;
+        }
+        chunks.push_back(std::make_pair(start, cut));
+        start = cut;
+    }
+
+    return chunks;
+}
+
+#endif
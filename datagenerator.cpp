@@ -0,0 +1,71 @@
+/**
+ * datagenerator.cpp
+ * Generates bonds.txt, prices.txt and marketdata.txt for load tests.
+ *
+ * Usage: datagenerator [--rows N] [--products N] [--seed N] [--threads N]
+ *                      [--bonds PATH] [--prices PATH] [--marketdata PATH] [--only bonds|prices|marketdata]
+ * --rows is the number of rows per product, products past the six bonds get synthetic identifiers.
+ * bonds.txt holds the same products, so the securities master can load all of them.
+ *
+ * @author Sijia Zhang
+ */
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "products.h"
+#include "positionservice.h"
+#include "riskservice.h"
+#include "support.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]){
+    //default to the files main() generates
+    long rows=GENERATOR_ROWS_PER_PRODUCT;
+    size_t products=CUSIPS_CONTAINER.size();
+    uint64_t seed=GENERATOR_SEED;
+    size_t threads=std::thread::hardware_concurrency();
+    std::string bonds=SECURITIES_MASTER_FILE, prices="../input/prices.txt", marketdata="../input/marketdata.txt", only;
+
+    for(int i=1;i+1<argc;i+=2){
+        std::string option=argv[i], value=argv[i+1];
+        if(option=="--rows") rows=std::stol(value);
+        else if(option=="--products") products=std::stoul(value);
+        else if(option=="--seed") seed=std::stoull(value);
+        else if(option=="--threads") threads=std::stoul(value);
+        else if(option=="--bonds") bonds=value;
+        else if(option=="--prices") prices=value;
+        else if(option=="--marketdata") marketdata=value;
+        else if(option=="--only") only=value;
+        else{
+            std::cout<<"Unknown option: "<<option<<std::endl;
+            return 1;
+        }
+    }
+
+    GeneratorConfig config={GeneratorProducts(CUSIPS_CONTAINER, products), rows, seed, threads};
+
+    auto start=std::chrono::steady_clock::now();
+    if(only.empty() || only=="bonds"){
+        if(!bond_file(products, bonds)){
+            std::cout<<"Failed to write "<<bonds<<std::endl;
+            return 1;
+        }
+    }
+    if(only.empty() || only=="prices"){
+        if(!GeneratePricesFile(prices, config)){
+            std::cout<<"Failed to write "<<prices<<std::endl;
+            return 1;
+        }
+    }
+    if(only.empty() || only=="marketdata"){
+        if(!GenerateMarketDataFile(marketdata, config)){
+            std::cout<<"Failed to write "<<marketdata<<std::endl;
+            return 1;
+        }
+    }
+    std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-start;
+
+    std::cout<<rows*products<<" rows per file generated in "<<elapsed.count()<<"s"<<std::endl;
+    return 0;
+}
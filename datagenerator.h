@@ -0,0 +1,344 @@
+/**
+ * datagenerator.hpp
+ * Defines the generator for the large price and market data input files.
+ * Every product draws from its own seeded random stream, so a file is reproduced exactly
+ * from the seed no matter how many threads generate it. Products are generated in parallel
+ * into part files through a buffered writer and then joined in product order.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef DATA_GENERATOR_HPP
+#define DATA_GENERATOR_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pricetick.h"
+
+using namespace std;
+
+/**
+ * Settings for a generator run.
+ */
+struct GeneratorConfig
+{
+    std::vector<std::string> products;   // product identifiers, one random stream each
+    long rowsPerProduct;                 // rows written for every product
+    uint64_t seed;                       // seed shared by all products
+    size_t threads;                      // threads generating products in parallel
+};
+
+/**
+ * Random stream of one product (splitmix64).
+ */
+class GeneratorRandom
+{
+
+public:
+
+    // ctor seeds the stream from the run seed and the product index
+    GeneratorRandom(uint64_t seed, uint64_t stream);
+
+    // Get the next 64 random bits
+    uint64_t Next();
+
+    // Get a random number in [0, n)
+    int Uniform(int n);
+
+private:
+    uint64_t state;
+
+};
+
+/**
+ * Writer that collects output in a large buffer and writes it out in big blocks.
+ */
+class BufferedWriter
+{
+
+public:
+
+    // ctor opens (and truncates) the file at the given path
+    explicit BufferedWriter(const std::string &path);
+
+    // dtor flushes and closes the file
+    ~BufferedWriter();
+
+    // Whether the file was opened
+    bool IsOpen() const;
+
+    // Append raw characters
+    void Append(const char *s, size_t n);
+
+    // Append a single character
+    void Append(char c);
+
+    // Append a decimal integer
+    void AppendInt(long value);
+
+    // Append a price given in 1/256 ticks in 32nds notation
+    void AppendPrice(int64_t ticks);
+
+    // Write out whatever is buffered
+    void Flush();
+
+    // Whether a write failed, the output is then incomplete
+    bool HasFailed() const;
+
+private:
+
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter& operator=(const BufferedWriter &) = delete;
+
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    int fd;
+    std::vector<char> buffer;
+    size_t used;
+    bool failed;
+
+};
+
+// Make product identifiers for a run, the given ones first and then synthetic ones up to count
+std::vector<std::string> GeneratorProducts(const std::vector<std::string> &known, size_t count);
+
+// Generate prices.txt: CUSIP, mid price and bid/offer spread
+bool GeneratePricesFile(const std::string &path, const GeneratorConfig &config);
+
+// Generate marketdata.txt: CUSIP and 5 levels of bid and offer price and quantity
+bool GenerateMarketDataFile(const std::string &path, const GeneratorConfig &config);
+
+
+
+//define member functions in class: GeneratorRandom
+GeneratorRandom::GeneratorRandom(uint64_t seed, uint64_t stream)
+{
+    state = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    Next();
+}
+
+uint64_t GeneratorRandom::Next()
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+int GeneratorRandom::Uniform(int n)
+{
+    //multiply-shift keeps the draw unbiased enough for test data without a division
+    return static_cast<int>(((Next() >> 32) * static_cast<uint64_t>(n)) >> 32);
+}
+
+
+
+//define member functions in class: BufferedWriter
+BufferedWriter::BufferedWriter(const std::string &path) :
+        buffer(BUFFER_SIZE), used(0), failed(false)
+{
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    Flush();
+    if (fd >= 0) close(fd);
+}
+
+bool BufferedWriter::IsOpen() const
+{
+    return fd >= 0;
+}
+
+void BufferedWriter::Append(const char *s, size_t n)
+{
+    if (used + n > buffer.size()) Flush();
+    memcpy(&buffer[used], s, n);
+    used += n;
+}
+
+void BufferedWriter::Append(char c)
+{
+    if (used == buffer.size()) Flush();
+    buffer[used++] = c;
+}
+
+void BufferedWriter::AppendInt(long value)
+{
+    if (used + PRICE_BUFFER_SIZE > buffer.size()) Flush();
+    used += FormatLong(value, &buffer[used]);
+}
+
+void BufferedWriter::AppendPrice(int64_t ticks)
+{
+    if (used + PRICE_BUFFER_SIZE > buffer.size()) Flush();
+    used += FormatPrice(ticks, &buffer[used]);
+}
+
+void BufferedWriter::Flush()
+{
+    size_t written = 0;
+    while (fd >= 0 && !failed && written < used) {
+        ssize_t n = write(fd, &buffer[written], used - written);
+        if (n < 0 && errno == EINTR) continue;
+
+        //anything else (a full disk, an I/O error) loses the rest of the buffer, remember it so the caller can tell
+        if (n <= 0) {
+            failed = true;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    used = 0;
+}
+
+bool BufferedWriter::HasFailed() const
+{
+    return failed;
+}
+
+
+
+std::vector<std::string> GeneratorProducts(const std::vector<std::string> &known, size_t count)
+{
+    std::vector<std::string> products(known.begin(), known.begin() + std::min(count, known.size()));
+
+    //synthetic identifiers are "SYN" and a sequence number of at least 6 digits, 9 characters like a CUSIP
+    //for the first million products and a digit longer for each further factor of 10
+    char id[24];
+    for (size_t i = products.size(); i < count; ++i) {
+        snprintf(id, sizeof(id), "SYN%06zu", i);
+        products.push_back(id);
+    }
+
+    return products;
+}
+
+/**
+ * Run one generator per product on a pool of threads, each writing to its own part file,
+ * then join the header and the parts in product order.
+ * The row writer is called as write(out, product, random) once per row.
+ */
+template<typename RowWriter>
+bool GenerateFile(const std::string &path, const std::string &header, const GeneratorConfig &config, RowWriter writeRow)
+{
+    size_t count = config.products.size();
+    std::vector<std::string> parts(count);
+    for (size_t i = 0; i < count; ++i) {
+        parts[i] = path + ".part" + std::to_string(i);
+    }
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    auto work = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            BufferedWriter out(parts[i]);
+            if (!out.IsOpen()) {
+                failed = true;
+                continue;
+            }
+            GeneratorRandom random(config.seed, i);
+            for (long row = 0; row < config.rowsPerProduct; ++row) {
+                writeRow(out, config.products[i], random);
+            }
+
+            //a part that was not written in full must not be joined
+            out.Flush();
+            if (out.HasFailed()) failed = true;
+        }
+    };
+
+    size_t threads = std::max<size_t>(1, std::min(config.threads, count));
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) {
+        pool.push_back(std::thread(work));
+    }
+    work();
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    //join the parts with sendfile so the data never comes back to user space
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = !failed && fd >= 0 && write(fd, header.data(), header.size()) == static_cast<ssize_t>(header.size());
+
+    for (size_t i = 0; i < count; ++i) {
+        int in = open(parts[i].c_str(), O_RDONLY);
+        struct stat st;
+        if (ok && in >= 0 && fstat(in, &st) == 0) {
+            off_t offset = 0;
+            while (offset < st.st_size) {
+                ssize_t n = sendfile(fd, in, &offset, st.st_size - offset);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        else {
+            ok = false;
+        }
+        if (in >= 0) close(in);
+        unlink(parts[i].c_str());
+    }
+
+    if (fd >= 0) close(fd);
+    return ok;
+}
+
+bool GeneratePricesFile(const std::string &path, const GeneratorConfig &config)
+{
+    return GenerateFile(path, "CUSIP,Mid_Price,Bid/Offer_Spread\n", config,
+                        [](BufferedWriter &out, const std::string &product, GeneratorRandom &random) {
+        //mid price inside 99-00 to 101-00, spread of 2, 3 or 4 ticks of 1/256
+        int64_t mid = 99 * 256 + random.Uniform(256 * 2 - 8) + 4;
+        int64_t spread = random.Uniform(3) + 2;
+
+        out.Append(product.data(), product.size());
+        out.Append(',');
+        out.AppendPrice(mid);
+        out.Append(',');
+        out.AppendPrice(spread);
+        out.Append('\n');
+    });
+}
+
+bool GenerateMarketDataFile(const std::string &path, const GeneratorConfig &config)
+{
+    return GenerateFile(path, "CUSIP,bidprice1,quantity,bidprice2,quantity,bidprice3,quantity,bidprice4,quantity,bidprice5,quantity,offerprice1,quantity,offerprice2,quantity,offerprice3,quantity,offerprice4,quantity,offerprice5,quantity,\n", config,
+                        [](BufferedWriter &out, const std::string &product, GeneratorRandom &random) {
+        //the spread widens from 1/128 by 1/128 each level for 4 levels, the 5th level is back at the top
+        int64_t mid = 99 * 256 + random.Uniform(256 * 2 + 1);
+
+        out.Append(product.data(), product.size());
+        out.Append(',');
+        for (int k = 1; k <= 5; ++k) {
+            out.AppendPrice(k <= 4 ? mid - k : mid - 1);
+            out.Append(',');
+            out.AppendInt(1000000L * k);
+            out.Append(',');
+        }
+        for (int k = 1; k <= 5; ++k) {
+            out.AppendPrice(k <= 4 ? mid + k : mid + 1);
+            out.Append(',');
+            out.AppendInt(1000000L * k);
+            out.Append(',');
+        }
+        out.Append('\n');
+    });
+}
+
+#endif
@@ -0,0 +1,270 @@
+/**
+ * edgequeue.hpp
+ * Defines the bounded queue on an edge between two services, and what happens when the consumer falls behind.
+ *
+ * BLOCK_PRODUCER makes the producer wait for room, so nothing is lost; it is the lock-free SpscQueue.
+ * DROP_OLDEST overwrites the oldest queued event, so a burst costs the consumer the events it was
+ * furthest behind on and never holds up the producer.
+ * CONFLATE_BY_KEY keeps at most one queued event per product: a new event replaces the one of its product
+ * still waiting, in its place in the queue, so a slow consumer only ever sees the latest state of each product.
+ * The two lossy policies use a ring under a mutex, held only to move a handle in or out.
+ *
+ * Every policy holds at most capacity events, and counts what happens on the edge in EdgeMetrics.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef EDGE_QUEUE_HPP
+#define EDGE_QUEUE_HPP
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <ostream>
+#include <cstdint>
+#include "snapshot.h"
+#include "spscqueue.h"
+
+using namespace std;
+
+// What an edge does when its queue is full
+enum OverflowPolicy { BLOCK_PRODUCER, DROP_OLDEST, CONFLATE_BY_KEY };
+
+// Get the name of a policy as the service graph config spells it
+const char* PolicyName(OverflowPolicy policy);
+
+// Get the policy named in a service graph config, return false if there is none by that name
+bool ParsePolicy(const std::string &name, OverflowPolicy &policy);
+
+/**
+ * What went through an edge so far.
+ */
+struct EdgeMetrics
+{
+    size_t capacity;
+    size_t depth;           // events queued now
+    size_t highWater;       // most events queued at once
+    uint64_t pushed;        // events the producer offered
+    uint64_t popped;        // events the consumer took
+    uint64_t dropped;       // events overwritten while still queued because the queue was full
+    uint64_t conflated;     // events replaced by a newer event of the same product
+    uint64_t blocked;       // times the producer found the queue full and waited
+};
+
+ostream& operator<<(ostream &output, const EdgeMetrics &metrics);
+
+// Get the product id an event belongs to, which decides its shard or its conflation slot
+template<typename V>
+const std::string& ProductKey(const V &data)
+{
+    return data.GetProduct().GetProductId();
+}
+
+/**
+ * A bounded queue of Snapshot<V> between one producer thread and one consumer thread.
+ */
+template<typename V>
+class EdgeQueue
+{
+
+public:
+
+    // ctor for a queue of capacity events handling overflow by policy
+    explicit EdgeQueue(size_t capacity = ASYNC_QUEUE_DEFAULT_CAPACITY, OverflowPolicy policy = BLOCK_PRODUCER);
+
+    // Get the overflow policy
+    OverflowPolicy GetPolicy() const;
+
+    // Queue an event (producer only), return how many more events are queued because of it: 0 if it took the place of another
+    int Push(const Snapshot<V> &item);
+
+    // Take the oldest event, return false if there is none (consumer only)
+    bool TryPop(Snapshot<V> &item);
+
+    // Whether no event is queued
+    bool IsEmpty() const;
+
+    // Get the metrics of the edge
+    EdgeMetrics GetMetrics() const;
+
+private:
+
+    // a queue cannot be copied
+    EdgeQueue(const EdgeQueue &) = delete;
+    EdgeQueue& operator=(const EdgeQueue &) = delete;
+
+    OverflowPolicy policy;
+    size_t capacity;
+
+    // BLOCK_PRODUCER
+    SpscQueue<Snapshot<V>> spsc;
+
+    // DROP_OLDEST and CONFLATE_BY_KEY
+    std::vector<Snapshot<V>> slots;
+    std::vector<std::string> slotKeys;                  // the product in each slot, for CONFLATE_BY_KEY
+    std::unordered_map<std::string, uint64_t> queued;   // the sequence number queued for each product
+    uint64_t head;
+    uint64_t tail;
+    size_t ringHighWater;
+    mutable std::mutex ring_mutex;
+
+    std::atomic<uint64_t> pushed;       // written by the producer only
+    std::atomic<uint64_t> popped;       // written by the consumer only
+    std::atomic<uint64_t> dropped;      // written by the producer only
+    std::atomic<uint64_t> conflated;    // written by the producer only
+    std::atomic<uint64_t> blocked;      // written by the producer only
+
+};
+
+
+
+const char* PolicyName(OverflowPolicy policy)
+{
+    switch (policy) {
+        case BLOCK_PRODUCER: return "block";
+        case DROP_OLDEST: return "drop_oldest";
+        case CONFLATE_BY_KEY: return "conflate";
+    }
+    return "?";
+}
+
+bool ParsePolicy(const std::string &name, OverflowPolicy &policy)
+{
+    for (OverflowPolicy p : {BLOCK_PRODUCER, DROP_OLDEST, CONFLATE_BY_KEY}) {
+        if (name == PolicyName(p)) {
+            policy = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+ostream& operator<<(ostream &output, const EdgeMetrics &metrics)
+{
+    output << "depth " << metrics.depth << " of " << metrics.capacity << ", high water " << metrics.highWater
+           << ", " << metrics.pushed << " pushed, " << metrics.popped << " popped, " << metrics.dropped << " dropped, "
+           << metrics.conflated << " conflated, producer blocked " << metrics.blocked << " times";
+    return output;
+}
+
+
+
+//define member functions in class: EdgeQueue
+template<typename V>
+EdgeQueue<V>::EdgeQueue(size_t _capacity, OverflowPolicy _policy) :
+        policy(_policy), capacity(_capacity > 0 ? _capacity : 1), spsc(_policy == BLOCK_PRODUCER ? capacity : 1),
+        head(0), tail(0), ringHighWater(0), pushed(0), popped(0), dropped(0), conflated(0), blocked(0)
+{
+    if (policy != BLOCK_PRODUCER) {
+        slots.resize(capacity);
+        if (policy == CONFLATE_BY_KEY) slotKeys.resize(capacity);
+    }
+}
+
+template<typename V>
+OverflowPolicy EdgeQueue<V>::GetPolicy() const
+{
+    return policy;
+}
+
+template<typename V>
+int EdgeQueue<V>::Push(const Snapshot<V> &item)
+{
+    pushed.store(pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if (policy == BLOCK_PRODUCER) {
+        if (!spsc.TryPush(item)) {
+            blocked.store(blocked.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            while (!spsc.TryPush(item)) {
+                std::this_thread::yield();
+            }
+        }
+        return 1;
+    }
+
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    if (policy == CONFLATE_BY_KEY) {
+        //a product already waiting gets its newer event in the same place
+        const std::string& key = ProductKey(*item);
+        auto it = queued.find(key);
+        if (it != queued.end()) {
+            slots[it->second % capacity] = item;
+            conflated.store(conflated.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return 0;
+        }
+    }
+
+    int added = 1;
+    if (head - tail == capacity) {
+        //make room by letting the oldest event go
+        uint64_t oldest = tail++ % capacity;
+        if (policy == CONFLATE_BY_KEY) queued.erase(slotKeys[oldest]);
+        slots[oldest] = Snapshot<V>();
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        added = 0;
+    }
+
+    uint64_t slot = head % capacity;
+    slots[slot] = item;
+    if (policy == CONFLATE_BY_KEY) {
+        slotKeys[slot] = ProductKey(*item);
+        queued[slotKeys[slot]] = head;
+    }
+    ++head;
+    if (head - tail > ringHighWater) ringHighWater = head - tail;
+    return added;
+}
+
+template<typename V>
+bool EdgeQueue<V>::TryPop(Snapshot<V> &item)
+{
+    if (policy == BLOCK_PRODUCER) {
+        if (!spsc.TryPop(item)) return false;
+    }
+    else {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+        if (head == tail) return false;
+
+        uint64_t slot = tail++ % capacity;
+        item = std::move(slots[slot]);
+        if (policy == CONFLATE_BY_KEY) queued.erase(slotKeys[slot]);
+    }
+
+    popped.store(popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+template<typename V>
+bool EdgeQueue<V>::IsEmpty() const
+{
+    if (policy == BLOCK_PRODUCER) return spsc.IsEmpty();
+
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    return head == tail;
+}
+
+template<typename V>
+EdgeMetrics EdgeQueue<V>::GetMetrics() const
+{
+    EdgeMetrics metrics;
+    metrics.capacity = policy == BLOCK_PRODUCER ? spsc.GetCapacity() : capacity;
+    if (policy == BLOCK_PRODUCER) {
+        metrics.depth = spsc.GetDepth();
+        metrics.highWater = spsc.GetHighWater();
+    }
+    else {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+        metrics.depth = head - tail;
+        metrics.highWater = ringHighWater;
+    }
+    metrics.pushed = pushed.load(std::memory_order_relaxed);
+    metrics.popped = popped.load(std::memory_order_relaxed);
+    metrics.dropped = dropped.load(std::memory_order_relaxed);
+    metrics.conflated = conflated.load(std::memory_order_relaxed);
+    metrics.blocked = blocked.load(std::memory_order_relaxed);
+    return metrics;
+}
+
+#endif
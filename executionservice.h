@@ -11,6 +11,7 @@
 #include <string>
 #include "soa.h"
 #include "marketdataservice.h"
+#include "pricetick.h"
 
 enum OrderType { FOK, IOC, MARKET, LIMIT, STOP };
 
@@ -27,10 +28,10 @@ class ExecutionOrder
 public:
 
     //ctor
-    ExecutionOrder(){};
+    ExecutionOrder() : productId(NO_PRODUCT) {};
 
     // ctor for an order
-    ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, double _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder);
+    ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, TickPrice _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder);
 
     // Get the product
     const T& GetProduct() const;
@@ -42,7 +43,7 @@ public:
     OrderType GetOrderType() const;
 
     // Get the price on this order
-    double GetPrice() const;
+    TickPrice GetPrice() const;
 
     // Get the visible quantity on this order
     long GetVisibleQuantity() const;
@@ -81,7 +82,10 @@ public:
             os<<"OTHERS!";
         }
 
-        os<<"Price is: "<<eo.GetPrice()<<", ";
+        char price[PRICE_BUFFER_SIZE];
+        os<<"Price is: ";
+        os.write(price, FormatDecimal(eo.GetPrice(), price));
+        os<<", ";
         os<<"VisibleQuantity is : "<<eo.GetVisibleQuantity()<<", ";
         os<<"HiddenQuantity is :"<<eo.GetHiddenQuantity()<<", ";
         os<<"ParentOrderId is :"<<eo.GetParentOrderId()<<", ";
@@ -91,11 +95,11 @@ public:
     }
 
 private:
-    T product;
+    ProductId productId;    // the product, interned in ProductTable<T>
     PricingSide side;
     string orderId;
     OrderType orderType;
-    double price;
+    TickPrice price;
     double visibleQuantity;
     double hiddenQuantity;
     string parentOrderId;
@@ -124,8 +128,8 @@ public:
 /*************************************************************************************/
 //define member functions in class: ExecutionOrder
 template<typename T>
-ExecutionOrder<T>::ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, double _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder) :
-        product(_product)
+ExecutionOrder<T>::ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, TickPrice _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder) :
+        productId(ProductTable<T>::Generate_Instance()->Intern(_product))
 {
     side = _side;
     orderId = _orderId;
@@ -143,7 +147,7 @@ ExecutionOrder<T>::ExecutionOrder(const T &_product, PricingSide _side, string _
 template<typename T>
 const T& ExecutionOrder<T>::GetProduct() const
 {
-    return product;
+    return ProductTable<T>::Generate_Instance()->Get(productId);
 }
 
 template<typename T>
@@ -159,7 +163,7 @@ OrderType ExecutionOrder<T>::GetOrderType() const
 }
 
 template<typename T>
-double ExecutionOrder<T>::GetPrice() const
+TickPrice ExecutionOrder<T>::GetPrice() const
 {
     return price;
 }
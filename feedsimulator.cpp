@@ -0,0 +1,103 @@
+/**
+ * feedsimulator.cpp
+ * Simulates the feed handler: writes order book updates into the shared memory ring read by
+ * MarketDataConnector::SubscribeShm, stamping each update with the time it was handed over.
+ *
+ * Usage: feedsimulator [--updates N] [--products N] [--rate N] [--seed N] [--capacity N] [--name NAME]
+ * --rate is in updates per second, 0 writes as fast as the consumer keeps up.
+ *
+ * @author Sijia Zhang
+ */
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "products.h"
+#include "positionservice.h"
+#include "riskservice.h"
+#include "support.h"
+#include "shmring.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]){
+    long updates=1000000;
+    size_t products=CUSIPS_CONTAINER.size();
+    long rate=100000;
+    uint64_t seed=GENERATOR_SEED;
+    uint64_t capacity=SHM_RING_DEFAULT_CAPACITY;
+    std::string name=SHM_RING_DEFAULT_NAME;
+
+    for(int i=1;i+1<argc;i+=2){
+        std::string option=argv[i], value=argv[i+1];
+        if(option=="--updates") updates=std::stol(value);
+        else if(option=="--products") products=std::stoul(value);
+        else if(option=="--rate") rate=std::stol(value);
+        else if(option=="--seed") seed=std::stoull(value);
+        else if(option=="--capacity") capacity=std::stoull(value);
+        else if(option=="--name") name=value;
+        else{
+            std::cout<<"Unknown option: "<<option<<std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::string> ids=GeneratorProducts(CUSIPS_CONTAINER, products);
+    if(ids.empty()){
+        std::cout<<"No products to simulate"<<std::endl;
+        return 1;
+    }
+
+    ShmRing<BookUpdate> ring;
+    if(!ring.Create(name, capacity)){
+        std::cout<<"Failed to create "<<name<<std::endl;
+        return 1;
+    }
+
+    //every product draws from its own stream like the market data generator
+    std::vector<GeneratorRandom> randoms;
+    for(size_t i=0;i<ids.size();++i){
+        randoms.push_back(GeneratorRandom(seed, i));
+    }
+
+    BookUpdate update;
+    memset(&update, 0, sizeof(update));
+    long full=0;
+
+    auto start=std::chrono::steady_clock::now();
+    for(long n=0;n<updates;++n){
+        //pace the updates, the tick time is when the update is due
+        if(rate>0){
+            auto due=start+std::chrono::nanoseconds(n*1000000000LL/rate);
+            while(std::chrono::steady_clock::now()<due){
+                std::this_thread::yield();
+            }
+        }
+
+        //products take turns, the book is 5 levels around a random mid like marketdata.txt
+        size_t p=n%ids.size();
+        int64_t mid=99*256+randoms[p].Uniform(256*2+1);
+        memset(update.product, 0, PRODUCT_ID_WIDTH);
+        memcpy(update.product, ids[p].data(), std::min(ids[p].size(), PRODUCT_ID_WIDTH));
+        for(int k=1;k<=BOOK_DEPTH;++k){
+            update.bidPrice[k-1]=(k<=4 ? mid-k : mid-1);
+            update.offerPrice[k-1]=(k<=4 ? mid+k : mid+1);
+            update.bidQuantity[k-1]=1000000L*k;
+            update.offerQuantity[k-1]=1000000L*k;
+        }
+        update.sequence=n;
+        update.timestamp=SteadyNanoseconds();
+
+        //a full ring means the consumer is behind, wait for it
+        if(!ring.TryPush(update)){
+            ++full;
+            while(!ring.TryPush(update)){
+                std::this_thread::yield();
+            }
+        }
+    }
+    ring.Close();
+    std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-start;
+
+    std::cout<<updates<<" updates written to "<<name<<" in "<<elapsed.count()<<"s, "<<full<<" times the ring was full"<<std::endl;
+    return 0;
+}
@@ -17,6 +17,7 @@
 #include <time.h>
 #include <thread>
 #include "pricingservice.h"
+#include "productindexedstore.h"
 
 using namespace std;
 /**
@@ -75,8 +76,8 @@ private:
     //define listener
     std::vector<ServiceListener<Price<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, Price<Bond>> gui_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<Price<Bond>> gui_data;
 
     //define Bond Historical Execution Connector
     BondGuiServiceConnector* bond_gui_connector;
@@ -176,8 +177,13 @@ void BondGuiServiceConnector::Publish(Price<Bond>& data)
 
     //put the data in
     if(of.is_open()){
-        std::string ss="Product: " + data.GetProduct().GetProductId() + ", Mid_price: "
-        + std::to_string(data.GetMid());
+        char mid[PRICE_BUFFER_SIZE];
+        std::string ss;
+        ss.reserve(64);
+        ss+="Product: ";
+        ss+=data.GetProduct().GetProductId();
+        ss+=", Mid_price: ";
+        ss.append(mid, FormatDecimal(data.GetMid(), mid));
 
         of<<ss<<std::endl;
     }
@@ -194,7 +200,7 @@ void BondGuiServiceConnector::Subscribe()
 //define member functions in class: BondGuiService
 Price<Bond>& BondGuiService::GetData(std::string key)
 {
-    return gui_data.at(key);
+    return gui_data.At(key);
 }
 
 void BondGuiService::OnMessage(Price<Bond> &data)
@@ -209,12 +215,11 @@ void BondGuiService::OnMessage(Price<Bond> &data)
     if (diff.count() >= 3e-1) {
 
         //store the newly or updated data
-        auto key=data.GetProduct().GetProductId(); //get key
-        gui_data.insert(std::make_pair(key,data));
+        gui_data.Insert(data.GetProduct().GetId(),data);
 
         //then, pass the updated data to listener
         //pass the trade data to listeners
-        std::cout<<"data goes from BondGuiService -> listener."<<'\n'<<std::endl;
+        LOG_TRACE("data goes from BondGuiService -> listener.");
         for(auto& l: listeners){
             l->ProcessAdd(data);
         }
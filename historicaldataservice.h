@@ -10,12 +10,14 @@
 #ifndef HISTORICAL_DATA_SERVICE_HPP
 #define HISTORICAL_DATA_SERVICE_HPP
 
+#include <mutex>
 #include "positionservice.h"
 #include "riskservice.h"
 #include "bondexecutionservice.h"
 #include "streamingservice.h"
 #include "inquiryservice.h"
 #include "support.h"
+#include "productindexedstore.h"
 
 /**
  * Service for processing and persisting historical data to a persistent store.
@@ -47,6 +49,9 @@ class BondHistoricalPositionConnector : public Connector<Position<Bond>>{
 
 private:
 
+    //keeps the lines of batches written from different shards apart
+    std::mutex file_mutex;
+
     //ctor
     BondHistoricalPositionConnector(){}
 
@@ -62,6 +67,10 @@ public:
     // Since it is a subscribe-only class, so there is no implementation in the Publish
     void Publish(Position<Bond>& data)  ;
 
+    // Publish a batch of positions (or snapshots of them), position.txt is opened once for the whole batch
+    template<typename Item>
+    void PublishBatch(const Item* data, size_t count);
+
     // Subscribe
     // It is used for reading data from file via OnMessage Method
     void Subscribe();
@@ -78,8 +87,11 @@ private:
     //define listener
     std::vector<ServiceListener<Position<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, Position<Bond>> pos_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<Position<Bond>> pos_data;
+
+    //guards pos_data, which shards may add to at the same time
+    std::mutex data_mutex;
 
     //define Bond Historical Position Connector
     BondHistoricalPositionConnector* bond_his_pos_connector;
@@ -105,6 +117,12 @@ public:
     // The callback that a Connector should invoke for any new or updated data
     void OnMessage(Position<Bond> &data)  ;
 
+    // The callback for a batch of new or updated data, the whole batch is handed to each listener at once
+    void OnMessageBatch(Position<Bond> *data, size_t count)  ;
+
+    // The callback for a batch of data shared as snapshots, the handles are passed on to each listener as they are
+    void OnMessageSnapshotBatch(const Snapshot<Position<Bond>> *data, size_t count)  ;
+
     // Add a listener to the Service for callbacks on add, remove, and update events
     // for data to the Service.
     void AddListener(ServiceListener<Position<Bond>> *listener)  ;
@@ -114,6 +132,10 @@ public:
 
     // make the data out
     void PersistData(string persistKey, Position<Bond>& data)  ;
+
+    // make a batch of data out
+    template<typename Item>
+    void PersistBatch(const Item* data, size_t count);
 };
 
 
@@ -152,6 +174,12 @@ public:
     // Listener callback to process an update event to the Service
     void ProcessUpdate(Position<Bond> &data)  ;
 
+    // Listener callback to process a batch of add events to the Service
+    void ProcessAddBatch(Position<Bond> *data, size_t count)  ;
+
+    // Listener callback to process a batch of add events shared as snapshots
+    void ProcessAddSnapshotBatch(const Snapshot<Position<Bond>> *data, size_t count)  ;
+
 };
 
 
@@ -170,6 +198,9 @@ class BondHistoricalPV01Connector : public Connector<PV01<Bond>>{
 
 private:
 
+    //keeps the lines of batches written from different shards apart
+    std::mutex file_mutex;
+
     //ctor
     BondHistoricalPV01Connector(){}
 
@@ -185,6 +216,10 @@ public:
     // Since it is a subscribe-only class, so there is no implementation in the Publish
     void Publish(PV01<Bond>& data)  ;
 
+    // Publish a batch of risks (or snapshots of them), the bucketed risks are read and risk.txt is opened once for the whole batch
+    template<typename Item>
+    void PublishBatch(const Item* data, size_t count);
+
     // Subscribe
     // It is used for reading data from file via OnMessage Method
     void Subscribe();
@@ -201,8 +236,11 @@ private:
     //define listener
     std::vector<ServiceListener<PV01<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, PV01<Bond>> pv01_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<PV01<Bond>> pv01_data;
+
+    //guards pv01_data, which shards may add to at the same time
+    std::mutex data_mutex;
 
     //define Bond Historical PV01 Connector
     BondHistoricalPV01Connector* bond_his_pv01_connector;
@@ -228,6 +266,15 @@ public:
     // The callback that a Connector should invoke for any new or updated data
     void OnMessage(PV01<Bond> &data);
 
+    // The callback for a batch of new or updated data, the whole batch is handed to each listener at once
+    void OnMessageBatch(PV01<Bond> *data, size_t count);
+
+    // The callback for a batch of data shared as snapshots, the handles are passed on to each listener as they are
+    void OnMessageSnapshotBatch(const Snapshot<PV01<Bond>> *data, size_t count);
+
+    // Store the data without notifying listeners
+    void ApplyPV01(const PV01<Bond> &data);
+
     // Add a listener to the Service for callbacks on add, remove, and update events
     // for data to the Service.
     void AddListener(ServiceListener<PV01<Bond>> *listener);
@@ -237,6 +284,10 @@ public:
 
     // make the data out
     void PersistData(string persistKey, PV01<Bond>& data);
+
+    // make a batch of data out
+    template<typename Item>
+    void PersistBatch(const Item* data, size_t count);
 };
 
 /**
@@ -274,6 +325,12 @@ public:
     // Listener callback to process an update event to the Service
     void ProcessUpdate(PV01<Bond> &data)  ;
 
+    // Listener callback to process a batch of add events to the Service
+    void ProcessAddBatch(PV01<Bond> *data, size_t count)  ;
+
+    // Listener callback to process a batch of add events shared as snapshots
+    void ProcessAddSnapshotBatch(const Snapshot<PV01<Bond>> *data, size_t count)  ;
+
 };
 
 
@@ -322,8 +379,8 @@ private:
     //define listener
     std::vector<ServiceListener<ExecutionOrder<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, ExecutionOrder<Bond>> execution_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<ExecutionOrder<Bond>> execution_data;
 
     //define Bond Historical Execution Connector
     BondHistoricalExecutionConnector* bond_his_exe_connector;
@@ -349,6 +406,9 @@ public:
     // The callback that a Connector should invoke for any new or updated data
     void OnMessage(ExecutionOrder<Bond> &data)  ;
 
+    // Store the data without notifying listeners
+    void ApplyExecutionOrder(ExecutionOrder<Bond> &data);
+
     // Add a listener to the Service for callbacks on add, remove, and update events
     // for data to the Service.
     void AddListener(ServiceListener<ExecutionOrder<Bond>> *listener)  ;
@@ -447,8 +507,8 @@ private:
     //define listener
     std::vector<ServiceListener<PriceStream<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, PriceStream<Bond>> streaming_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<PriceStream<Bond>> streaming_data;
 
     //define Bond Historical Execution Connector
     BondHistoricalStreamingConnector* bond_his_stream_connector;
@@ -652,22 +712,34 @@ public:
 /***************************************************************************/
 //define member functions in class BondHistoricalPositionConnector
 void BondHistoricalPositionConnector::Publish(Position<Bond>& data)
+{
+    PublishBatch(&data, 1);
+}
+
+template<typename Item>
+void BondHistoricalPositionConnector::PublishBatch(const Item* data, size_t count)
 {
     std::string s1="TRSY1", s2="TRSY2", s3="TRSY3";
 
     //create a new .txt and put the data of position in it
+    std::lock_guard<std::mutex> lock(file_mutex);
     ofstream of;
     of.open("../output/position.txt" ,ios::app);
 
     //put the data in
     if(of.is_open()){
-        //we should persist each position for a given book as well as the aggregate position.
-        std::string ss= "ProductId: " + data.GetProduct().GetProductId() + "BOOK : TRSY1, total position: " + std::to_string(data.GetPosition(s1)) + ", BOOK : TRSY2, total position:"
-        + std::to_string(data.GetPosition(s2)) + ", BOOK : TRSY3, total position: " + std::to_string(data.GetPosition(s3))
-        + ", Aggregate position: " + std::to_string(data.GetAggregatePosition());
-
-        //Persist each position for 3 kinds of books! Note: Positions for a given book added from previous state if a new trade is read!
-        of<<ss<<std::endl;
+        for(size_t i=0;i<count;++i){
+            const Position<Bond>& pos=SnapshotValue(data[i]);
+
+            //we should persist each position for a given book as well as the aggregate position.
+            std::string ss= "ProductId: " + pos.GetProduct().GetProductId() + "BOOK : TRSY1, total position: " + std::to_string(pos.GetPosition(s1)) + ", BOOK : TRSY2, total position:"
+            + std::to_string(pos.GetPosition(s2)) + ", BOOK : TRSY3, total position: " + std::to_string(pos.GetPosition(s3))
+            + ", Aggregate position: " + std::to_string(pos.GetAggregatePosition());
+
+            //Persist each position for 3 kinds of books! Note: Positions for a given book added from previous state if a new trade is read!
+            of<<ss<<'\n';
+        }
+        of.flush();
     }
 
 }
@@ -684,23 +756,59 @@ void BondHistoricalPositionConnector::Subscribe()
 //define member functions in class: BondHistoricalPositionService
 Position<Bond>& BondHistoricalPositionService::GetData(std::string key)
 {
-    return pos_data.at(key);
+    return pos_data.At(key);
 }
 
 void BondHistoricalPositionService::OnMessage(Position<Bond> &data)
 {
     //firstly, store the newly or updated data
-    std::string key=data.GetProduct().GetProductId(); //get key
-    pos_data.insert(std::make_pair(key,data));
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        pos_data.Insert(data.GetProduct().GetId(),data);
+    }
 
     //then, pass the updated data to listener
     //pass the trade data to listeners
-    std::cout<<"data goes from BondHistoricalPositionService -> listener."<<'\n'<<std::endl;
+    LOG_TRACE("data goes from BondHistoricalPositionService -> listener.");
     for(auto& l: listeners){
         l->ProcessAdd(data);
     }
 }
 
+void BondHistoricalPositionService::OnMessageBatch(Position<Bond> *data, size_t count)
+{
+    //firstly, store the newly or updated data
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        for(size_t i=0;i<count;++i){
+            pos_data.Insert(data[i].GetProduct().GetId(),data[i]);
+        }
+    }
+
+    //then, pass the batch to listener
+    LOG_TRACE("data goes from BondHistoricalPositionService -> listener. (%lu positions)", count);
+    for(auto& l: listeners){
+        l->ProcessAddBatch(data, count);
+    }
+}
+
+void BondHistoricalPositionService::OnMessageSnapshotBatch(const Snapshot<Position<Bond>> *data, size_t count)
+{
+    //firstly, store the newly or updated data
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        for(size_t i=0;i<count;++i){
+            pos_data.Insert(data[i]->GetProduct().GetId(),*data[i]);
+        }
+    }
+
+    //then, pass the batch to listener
+    LOG_TRACE("data goes from BondHistoricalPositionService -> listener. (%lu positions)", count);
+    for(auto& l: listeners){
+        l->ProcessAddSnapshotBatch(data, count);
+    }
+}
+
 void BondHistoricalPositionService::AddListener(ServiceListener<Position<Bond>> *listener)
 {
     listeners.push_back(listener);
@@ -717,6 +825,12 @@ void BondHistoricalPositionService::PersistData(string persistKey, Position<Bond
     bond_his_pos_connector->Publish(data);
 }
 
+template<typename Item>
+void BondHistoricalPositionService::PersistBatch(const Item* data, size_t count)
+{
+    bond_his_pos_connector->PublishBatch(data, count);
+}
+
 
 
 //define member function in class: BondHistoricalPositionServiceListener
@@ -728,6 +842,22 @@ void BondHistoricalPositionServiceListener::ProcessAdd(Position<Bond> &data)
     bond_his_pos_service->PersistData(data.GetProduct().GetProductId(),data);
 }
 
+void BondHistoricalPositionServiceListener::ProcessAddBatch(Position<Bond> *data, size_t count)
+{
+    bond_his_pos_service->OnMessageBatch(data, count);
+
+    //write them
+    bond_his_pos_service->PersistBatch(data, count);
+}
+
+void BondHistoricalPositionServiceListener::ProcessAddSnapshotBatch(const Snapshot<Position<Bond>> *data, size_t count)
+{
+    bond_his_pos_service->OnMessageSnapshotBatch(data, count);
+
+    //write them
+    bond_his_pos_service->PersistBatch(data, count);
+}
+
 void BondHistoricalPositionServiceListener::ProcessRemove(Position<Bond> &data)
 {
     // no implementation
@@ -744,30 +874,25 @@ void BondHistoricalPositionServiceListener::ProcessUpdate(Position<Bond> &data)
 //define member functions in class: BondHistoricalPV01Connector
 void BondHistoricalPV01Connector::Publish(PV01<Bond>& data)
 {
-    //firstly, define a group of busket
-    //define FrontEnd Bucket
-    std::vector<Bond> front_end{GetBond(cusip1_year_2), GetBond(cusip2_year_3)};
-    BucketedSector<Bond> FrontEnd_sector(front_end, "FrontEnd");
-
-    //define Belly busket
-    std::vector<Bond> belly{GetBond(cusip3_year_5), GetBond(cusip4_year_7), GetBond(cusip5_year_10)};
-    BucketedSector<Bond> Belly_sector(belly, "Belly");
-
-    //define LongEnd busket
-    std::vector<Bond> Long_end{GetBond(cusip6_year_30)};
-    BucketedSector<Bond> LongEnd_sector(Long_end, "LongEnd");
-
-    RiskService * rs=RiskService::Generate_Instance();
+    PublishBatch(&data, 1);
+}
 
-    //Then, write the file
+template<typename Item>
+void BondHistoricalPV01Connector::PublishBatch(const Item* data, size_t count)
+{
     //we should persist risk for each security as well as for the following bucket sectors: FrontEnd (2Y, 3Y), Belly (5Y, 7Y, 10Y), and LongEnd (30Y).
+    //each risk carries the bucket totals RiskService had right after risking it, so only the writing is batched
+    std::lock_guard<std::mutex> lock(file_mutex);
     ofstream of("../output/risk.txt", ios_base::app);
-    std::string ss = "Product: " + data.GetProduct().GetProductId() + ", PV01: " + std::to_string(data.GetPV01())
-    + ", Total Risk(FrontEnd): " + std::to_string(rs->GetBucketedRisk(FrontEnd_sector))
-    + ", Total Risk(Belly): "+ std::to_string(rs->GetBucketedRisk(Belly_sector))
-    + ", Total Risk(LongEnd): "+std::to_string(rs->GetBucketedRisk(LongEnd_sector));
-
-    of<<ss<<std::endl;
+    for(size_t i=0;i<count;++i){
+        const PV01<Bond>& pv=SnapshotValue(data[i]);
+        std::string ss = "Product: " + pv.GetProduct().GetProductId() + ", PV01: " + std::to_string(pv.GetPV01())
+        + ", Total Risk(FrontEnd): " + std::to_string(pv.GetBucketedRisk(FRONT_END))
+        + ", Total Risk(Belly): "+ std::to_string(pv.GetBucketedRisk(BELLY))
+        + ", Total Risk(LongEnd): "+std::to_string(pv.GetBucketedRisk(LONG_END));
+        of<<ss<<'\n';
+    }
+    of.flush();
 }
 
 void BondHistoricalPV01Connector::Subscribe()
@@ -782,18 +907,52 @@ void BondHistoricalPV01Connector::Subscribe()
 //define member functions in class: BondHistoricalPV01Service
 PV01<Bond>& BondHistoricalPV01Service::GetData(std::string key)
 {
-    return pv01_data.at(key);
+    return pv01_data.At(key);
+}
+
+void BondHistoricalPV01Service::ApplyPV01(const PV01<Bond> &data)
+{
+    //store the newly or updated data
+    std::lock_guard<std::mutex> lock(data_mutex);
+    pv01_data.Insert(data.GetProduct().GetId(),data);
+}
+
+void BondHistoricalPV01Service::OnMessageBatch(PV01<Bond> *data, size_t count)
+{
+    //firstly, store the newly or updated data
+    for(size_t i=0;i<count;++i){
+        ApplyPV01(data[i]);
+    }
+
+    //then, pass the batch to listener
+    LOG_TRACE("data goes from BondHistoricalPV01Service -> listener. (%lu risks)", count);
+    for(auto& l: listeners){
+        l->ProcessAddBatch(data, count);
+    }
+}
+
+void BondHistoricalPV01Service::OnMessageSnapshotBatch(const Snapshot<PV01<Bond>> *data, size_t count)
+{
+    //firstly, store the newly or updated data
+    for(size_t i=0;i<count;++i){
+        ApplyPV01(*data[i]);
+    }
+
+    //then, pass the batch to listener
+    LOG_TRACE("data goes from BondHistoricalPV01Service -> listener. (%lu risks)", count);
+    for(auto& l: listeners){
+        l->ProcessAddSnapshotBatch(data, count);
+    }
 }
 
 void BondHistoricalPV01Service::OnMessage(PV01<Bond> &data)
 {
     //firstly, store the newly or updated data
-    auto key=data.GetProduct().GetProductId(); //get key
-    pv01_data.insert(std::make_pair(key,data));
+    ApplyPV01(data);
 
     //then, pass the updated data to listener
     //pass the trade data to listeners
-    std::cout<<"data goes from BondHistoricalPV01Service -> listener."<<'\n'<<std::endl;
+    LOG_TRACE("data goes from BondHistoricalPV01Service -> listener.");
 
     for(auto& l: listeners){
         l->ProcessAdd(data);
@@ -816,6 +975,12 @@ void BondHistoricalPV01Service::PersistData(string persistKey, PV01<Bond>& data)
     bond_his_pv01_connector->Publish(data);
 }
 
+template<typename Item>
+void BondHistoricalPV01Service::PersistBatch(const Item* data, size_t count)
+{
+    bond_his_pv01_connector->PublishBatch(data, count);
+}
+
 
 
 
@@ -828,6 +993,22 @@ void BondHistoricalPV01ServiceListener::ProcessAdd(PV01<Bond> &data)
     bond_his_pv01_service->PersistData(data.GetProduct().GetProductId(),data);
 }
 
+void BondHistoricalPV01ServiceListener::ProcessAddBatch(PV01<Bond> *data, size_t count)
+{
+    bond_his_pv01_service->OnMessageBatch(data, count);
+
+    //write them
+    bond_his_pv01_service->PersistBatch(data, count);
+}
+
+void BondHistoricalPV01ServiceListener::ProcessAddSnapshotBatch(const Snapshot<PV01<Bond>> *data, size_t count)
+{
+    bond_his_pv01_service->OnMessageSnapshotBatch(data, count);
+
+    //write them
+    bond_his_pv01_service->PersistBatch(data, count);
+}
+
 void BondHistoricalPV01ServiceListener::ProcessRemove(PV01<Bond> &data)
 {
     // no implementation
@@ -868,18 +1049,23 @@ void BondHistoricalExecutionConnector::Subscribe()
 //define member functions in class: BondHistoricalExecutionService
 ExecutionOrder<Bond>& BondHistoricalExecutionService::GetData(std::string key)
 {
-    return execution_data.at(key);
+    return execution_data.At(key);
+}
+
+void BondHistoricalExecutionService::ApplyExecutionOrder(ExecutionOrder<Bond> &data)
+{
+    //store the newly or updated data
+    execution_data.Insert(data.GetProduct().GetId(),data);
 }
 
 void BondHistoricalExecutionService::OnMessage(ExecutionOrder<Bond> &data)
 {
     //firstly, store the newly or updated data
-    auto key=data.GetProduct().GetProductId(); //get key
-    execution_data.insert(std::make_pair(key,data));
+    ApplyExecutionOrder(data);
 
     //then, pass the updated data to listener
     //pass the trade data to listeners
-    std::cout<<"data goes from BondHistoricalExecutionService -> listener."<<'\n'<<std::endl;
+    LOG_TRACE("data goes from BondHistoricalExecutionService -> listener.");
     for(auto& l: listeners){
         l->ProcessAdd(data);
     }
@@ -925,21 +1111,34 @@ void BondHistoricalStreamingConnector::Publish(PriceStream<Bond>& data)
     of.open("../output/streaming.txt" ,ios::app);
 
     //summarize the input
-    double bid_price=data.GetBidOrder().GetPrice();
-    double offer_price=data.GetOfferOrder().GetPrice();
+    TickPrice bid_price=data.GetBidOrder().GetPrice();
+    TickPrice offer_price=data.GetOfferOrder().GetPrice();
 
-    double bid_vq=data.GetBidOrder().GetVisibleQuantity();
-    double offer_vq=data.GetOfferOrder().GetVisibleQuantity();
+    long bid_vq=data.GetBidOrder().GetVisibleQuantity();
+    long offer_vq=data.GetOfferOrder().GetVisibleQuantity();
 
-    double bid_hq=data.GetBidOrder().GetHiddenQuantity();
-    double offer_hq=data.GetOfferOrder().GetHiddenQuantity();
+    long bid_hq=data.GetBidOrder().GetHiddenQuantity();
+    long offer_hq=data.GetOfferOrder().GetHiddenQuantity();
 
-    //put the data in
+    //put the data in, every number is formatted straight into the line
     if(of.is_open()){
-        std::string ss="Product: " + data.GetProduct().GetProductId() + " , Bid Price: "
-        + std::to_string(bid_price) + " , Bid Visible Quantity: " + std::to_string((int)bid_vq)
-        + ", Bid Hidden Quantity: " + std::to_string((int)bid_hq) + " , Offer Price: " + std::to_string(offer_price)
-        +  ", Offer Visible Quantity: " + std::to_string((int)offer_vq) + ", Offer Hidden Quantity: " + std::to_string((int)offer_hq);
+        char buffer[PRICE_BUFFER_SIZE];
+        std::string ss;
+        ss.reserve(256);
+        ss+="Product: ";
+        ss+=data.GetProduct().GetProductId();
+        ss+=" , Bid Price: ";
+        ss.append(buffer, FormatDecimal(bid_price, buffer));
+        ss+=" , Bid Visible Quantity: ";
+        ss.append(buffer, FormatLong(bid_vq, buffer));
+        ss+=", Bid Hidden Quantity: ";
+        ss.append(buffer, FormatLong(bid_hq, buffer));
+        ss+=" , Offer Price: ";
+        ss.append(buffer, FormatDecimal(offer_price, buffer));
+        ss+=", Offer Visible Quantity: ";
+        ss.append(buffer, FormatLong(offer_vq, buffer));
+        ss+=", Offer Hidden Quantity: ";
+        ss.append(buffer, FormatLong(offer_hq, buffer));
 
         of<<ss<<std::endl;
     }
@@ -954,18 +1153,17 @@ void BondHistoricalStreamingConnector::Subscribe()
 //define member functions in class: BondHistoricalStreamingService
 PriceStream<Bond>& BondHistoricalStreamingService::GetData(std::string key)
 {
-    return streaming_data.at(key);
+    return streaming_data.At(key);
 }
 
 void BondHistoricalStreamingService::OnMessage(PriceStream<Bond> &data)
 {
     //firstly, store the newly or updated data
-    auto key=data.GetProduct().GetProductId(); //get key
-    streaming_data.insert(std::make_pair(key,data));
+    streaming_data.Insert(data.GetProduct().GetId(),data);
 
     //then, pass the updated data to listener
     //pass the trade data to listeners
-    std::cout<<"data goes from BondHistoricalStreamingService -> listener."<<'\n'<<std::endl;
+    LOG_TRACE("data goes from BondHistoricalStreamingService -> listener.");
     for(auto& l: listeners){
         l->ProcessAdd(data);
     }
@@ -1042,7 +1240,7 @@ void BondHistoricalInquiryService::OnMessage(Inquiry<Bond> &data)
 
     //then, pass the updated data to listener
     //pass the trade data to listeners
-    std::cout<<"data goes from BondHistoricalInquiryService -> listener."<<'\n'<<std::endl;
+    LOG_TRACE("data goes from BondHistoricalInquiryService -> listener.");
     for(auto& l: listeners){
         l->ProcessAdd(data);
     }
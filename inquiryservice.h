@@ -17,6 +17,9 @@
 // Various inqyury states
 enum InquiryState { RECEIVED, QUOTED, DONE, REJECTED, CUSTOMER_REJECTED };
 
+// Parse an inquiry state written as its name
+ParseResult ParseInquiryState(boost::string_view s, InquiryState &state);
+
 /**
  * Inquiry object modeling a customer inquiry from a client.
  * Type T is the product type.
@@ -28,7 +31,7 @@ class Inquiry
 public:
 
     // ctor for an inquiry
-    Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state);
+    Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, TickPrice _price, InquiryState _state);
 
     // Get the inquiry ID
     const string& GetInquiryId() const;
@@ -43,7 +46,7 @@ public:
     long GetQuantity() const;
 
     // Get the price that we have responded back with
-    double GetPrice() const;
+    TickPrice GetPrice() const;
 
     // Get the current state on the inquiry
     InquiryState GetState() const;
@@ -54,7 +57,7 @@ public:
     }
 
     //define a change price member function
-    void ChangePrice(double pri){
+    void ChangePrice(TickPrice pri){
         price=pri;
     }
 
@@ -80,10 +83,10 @@ public:
 
 private:
     string inquiryId;
-    T product;
+    ProductId productId;    // the product, interned in ProductTable<T>
     Side side;
     long quantity;
-    double price;
+    TickPrice price;
     InquiryState state;
 
 };
@@ -100,7 +103,7 @@ class InquiryService : public Service<string,Inquiry <T> >
 public:
 
     // Send a quote back to the client
-    virtual void SendQuote(const string &inquiryId, double price) = 0;
+    virtual void SendQuote(const string &inquiryId, TickPrice price) = 0;
 
     // Reject an inquiry from the client
     virtual void RejectInquiry(const string &inquiryId) = 0;
@@ -149,7 +152,7 @@ public:
     const std::vector< ServiceListener<Inquiry<Bond>>* >& GetListeners() const  ;
 
     // Send a quote back to the client
-    void SendQuote(const string &inquiryId, double price)  ;
+    void SendQuote(const string &inquiryId, TickPrice price)  ;
 
     // Reject an inquiry from the client
     void RejectInquiry(const string &inquiryId)  ;
@@ -169,6 +172,9 @@ private:
     BondProductService * bond_product_service;
     BondInquiryService * bond_inquiry_service;
 
+    //lines read and skipped in the last file subscribed
+    ParseStats stats;
+
     //ctor
     BondInquiryServiceConnector(){
         bond_inquiry_service=BondInquiryService::Generate_Instance();
@@ -192,6 +198,14 @@ public:
     // It is used for reading data from file via OnMessage Method
     void Subscribe();
 
+    // SubscribeSocket
+    // It is used for reading inquiries pushed as INQUIRY_MESSAGEs over a Unix domain socket (see messagesocket.h).
+    // It waits for one sender, passes the inquiries of every read to OnMessage as a batch and returns when the sender closes
+    void SubscribeSocket(const std::string &path = INQUIRY_SOCKET_PATH);
+
+    // Get the counts of lines read and skipped in the last file subscribed
+    const ParseStats& GetParseStats() const;
+
     // GetService
     InquiryService<Bond>* GetService();
 
@@ -200,8 +214,8 @@ public:
 /***********************************************************************************************/
 //define member functions in class: Inquiry
 template<typename T>
-Inquiry<T>::Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state) :
-        product(_product)
+Inquiry<T>::Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, TickPrice _price, InquiryState _state) :
+        productId(ProductTable<T>::Generate_Instance()->Intern(_product))
 {
     inquiryId = _inquiryId;
     side = _side;
@@ -219,7 +233,7 @@ const string& Inquiry<T>::GetInquiryId() const
 template<typename T>
 const T& Inquiry<T>::GetProduct() const
 {
-    return product;
+    return ProductTable<T>::Generate_Instance()->Get(productId);
 }
 
 template<typename T>
@@ -235,7 +249,7 @@ long Inquiry<T>::GetQuantity() const
 }
 
 template<typename T>
-double Inquiry<T>::GetPrice() const
+TickPrice Inquiry<T>::GetPrice() const
 {
     return price;
 }
@@ -248,6 +262,32 @@ InquiryState Inquiry<T>::GetState() const
 
 
 
+ParseResult ParseInquiryState(boost::string_view s, InquiryState &state)
+{
+    if(s.empty()) return ParseResult{s.data(), PARSE_EMPTY_FIELD};
+    if(s=="RECEIVED"){
+        state=RECEIVED;
+    }
+    else if(s=="QUOTED"){
+        state=QUOTED;
+    }
+    else if(s=="DONE"){
+        state=DONE;
+    }
+    else if(s=="REJECTED"){
+        state=REJECTED;
+    }
+    else if(s=="CUSTOMER_REJECTED"){
+        state=CUSTOMER_REJECTED;
+    }
+    else{
+        return ParseResult{s.data(), PARSE_UNKNOWN_VALUE};
+    }
+    return ParseResult{s.data()+s.size(), PARSE_OK};
+}
+
+
+
 //define member functions in class BondInquiryService
 Inquiry<Bond>& BondInquiryService::GetData(std::string key)  
 {
@@ -264,7 +304,7 @@ void BondInquiryService::OnMessage(Inquiry<Bond> &data)
         inquiry_data.insert(std::make_pair(data.GetInquiryId(),data));
 
         //transform the data to listener
-        std::cout<<"data goes from BondInquiryService -> listener."<<std::endl;
+        LOG_TRACE("data goes from BondInquiryService -> listener.");
         inquiry_data.insert(std::make_pair(data.GetInquiryId(),data));
         for(auto& l: listeners){
             l->ProcessAdd(data);
@@ -274,7 +314,7 @@ void BondInquiryService::OnMessage(Inquiry<Bond> &data)
     else {
         //send back nothing
         //transform the data to listener
-        std::cout<<"data goes from BondInquiryService -> listener."<<std::endl;
+        LOG_TRACE("data goes from BondInquiryService -> listener.");
         for(auto& l: listeners){
             l->ProcessAdd(data);
         }
@@ -291,7 +331,7 @@ const std::vector< ServiceListener<Inquiry<Bond>>* >& BondInquiryService::GetLis
     return listeners;
 }
 
-void BondInquiryService::SendQuote(const string &inquiryId, double price)  
+void BondInquiryService::SendQuote(const string &inquiryId, TickPrice price)  
 {
     // don't use this function
 }
@@ -307,91 +347,136 @@ void BondInquiryService::RejectInquiry(const string &inquiryId)
 //define member functions in class BondInquiryServiceConnector
 void BondInquiryServiceConnector::Publish(Inquiry<Bond>& data)  
 {
-    data.ChangePrice(100.00);
+    data.ChangePrice(TickPrice(100 * TICKS_PER_POINT));
 }
 
 void BondInquiryServiceConnector::Subscribe()
 {
-    //define some strings we will use later
-    std::string key, side, quantity, price, state;
-
-    //lambda function working to split one line and return vector of parts
-    auto splitoneline = [](std::string line){
-        stringstream ss(line);
-        std::string part; //define each part in the line
-        std::vector<std::string> container; //define container to contain each part and return it
-
-        while(getline(ss,part,',')){
-            container.push_back(part); //using comma as our separate signal
-        }
-
-        return container;
-    };
-
-    //lambda function working to transposing price of the bond
-    auto PriceTranspose = [](std::string s){
-        size_t pos=s.find_first_of('-'); //position of the '-'
+    //map the file and do subscribing
+    stats=ParseStats("input/inquiries.txt");
+    MappedFile file("../input/inquiries.txt");
+    if(!file.IsOpen()){
+        std::cout<<"input/inquiries.txt cannot be opened!"<<std::endl;
+        return;
+    }
 
-        //we use std::stoi to transpose string to double
-        //firstly, calculate the value of the first part before pos '-'
-        double value=std::stoi(s.substr(0,pos));
+    CsvLineReader reader(file.Begin(), file.End());
+    reader.NextLine(); //skip the header
 
-        //then, calculate the first value after '-', 2 char in the string
-        int temp1=std::stoi(s.substr(pos+1,2));
+    //each line holds a CUSIP, side, quantity, price and state
+    boost::string_view container[5];
 
-        //at the same time, calculate the last value in s
-        auto last=s[s.size()-1];
-        if(last=='+'){
-            last='4';
+    while(reader.NextLine()){
+        if(reader.GetLine().empty()){
+            continue;
         }
-        int temp2=last-'0';
-
-        //finally, add them up and get the final value
-        double final_value=value+(temp1/32.+temp2/256.);
-        return final_value;
-    };
 
-    //read the file and do subscribing
-    ifstream iss("../input/inquiries.txt");
-    std::string line;
-    getline(iss,line);
-
-    //if the file is not empty
-    while(getline(iss, line)){
+        //parse the line, bad lines are skipped and counted
+        Side side=BUY;
+        long quantity=0;
+        int64_t price=0;
+        InquiryState state=RECEIVED;
+        ParseErrc ec=PARSE_OK;
+        if(reader.Split(container, 5)<5){
+            ec=PARSE_MISSING_FIELDS;
+        }
+        else if(container[0].empty()){
+            ec=PARSE_EMPTY_FIELD;
+        }
+        else{
+            ParseResult r=ParseSide(container[1], side);
+            if(r.ec==PARSE_OK) r=ParseLong(container[2], quantity);
+            if(r.ec==PARSE_OK) r=ParsePriceTicks(container[3], price);
+            if(r.ec==PARSE_OK) r=ParseInquiryState(container[4], state);
+            ec=r.ec;
+        }
+        stats.CountLine(ec);
+        if(ec!=PARSE_OK){
+            continue;
+        }
 
         //define inquiry id
         static int inquiryID=0;
         ++inquiryID;
 
-        //create a vector to contain the parts in each line
-        std::vector<std::string> container=splitoneline(line);
-
-        //using the string defined above as the name of different parts
-        key=container[0];
-        side=container[1];
-        quantity=container[2];
-        price=container[3];
-        state=container[4];
-
-        InquiryState real_state;
-        if(state=="RECEIVED"){
-            real_state==RECEIVED;
-        }
         //define an Inquiry
-        auto bond=bond_product_service->GetData(key);
-        Inquiry<Bond> inb("INQ"+std::to_string(inquiryID), bond, (side == "BUY" ? BUY : SELL),static_cast<long>(std::stol(quantity)),std::stoi(price),real_state);
+        const Bond& bond=bond_product_service->GetData(std::string(container[0].data(), container[0].size()));
+        Inquiry<Bond> inb("INQ"+std::to_string(inquiryID), bond, side, quantity, TickPrice(price), state);
 
         //send back a quote
-        bond_inquiry_service->SendQuote(std::to_string(inquiryID), std::stoi(price));
+        bond_inquiry_service->SendQuote(std::to_string(inquiryID), TickPrice(price));
 
         //set the state to QUOTE
         inb.ChangeState(QUOTED);
         bond_inquiry_service->OnMessage(inb);
     }
 
+    std::cout<<stats<<std::endl;
     std::cout<<"input/inquiries.txt -> BondInquiryService DONE!"<<std::endl;
 }
 
+void BondInquiryServiceConnector::SubscribeSocket(const std::string &path)
+{
+    MessageSocketReader reader;
+    if(!reader.Listen(path) || !reader.Accept()){
+        std::cout<<path<<" cannot be listened on!"<<std::endl;
+        return;
+    }
+    stats=ParseStats(path);
+
+    std::vector<Inquiry<Bond>> batch;
+    MessageHeader header;
+    const char* payload;
+    InquiryMessage message;
+
+    while(reader.Drain()){
+        //turn every complete message of this read into an inquiry, bad messages are skipped and counted
+        batch.clear();
+        while(reader.Next(header, payload)){
+            if(header.type!=INQUIRY_MESSAGE){
+                stats.CountLine(PARSE_UNKNOWN_VALUE);
+                continue;
+            }
+            if(header.length!=sizeof(InquiryMessage)){
+                stats.CountLine(PARSE_MISSING_FIELDS);
+                continue;
+            }
+            memcpy(&message, payload, sizeof(message));
+            if(message.product[0]=='\0' || message.inquiryId[0]=='\0'){
+                stats.CountLine(PARSE_EMPTY_FIELD);
+                continue;
+            }
+            if(message.side>SELL || message.state>CUSTOMER_REJECTED || message.price<0){
+                stats.CountLine(PARSE_OUT_OF_RANGE);
+                continue;
+            }
+            stats.CountLine(PARSE_OK);
+
+            //define an Inquiry
+            const Bond& bond=bond_product_service->GetData(GetMessageField(message.product));
+            batch.push_back(Inquiry<Bond>(GetMessageField(message.inquiryId), bond, static_cast<Side>(message.side),
+                                          message.quantity, TickPrice(message.price), static_cast<InquiryState>(message.state)));
+        }
+
+        for(auto& inb:batch){
+            //send back a quote
+            bond_inquiry_service->SendQuote(inb.GetInquiryId(), inb.GetPrice());
+
+            //set the state to QUOTE
+            inb.ChangeState(QUOTED);
+            bond_inquiry_service->OnMessage(inb);
+        }
+    }
+
+    std::cout<<stats<<" in "<<reader.GetDrains()<<" reads"<<std::endl;
+    std::cout<<path<<" -> BondInquiryService DONE!"<<std::endl;
+}
+
+const ParseStats& BondInquiryServiceConnector::GetParseStats() const
+{
+    return stats;
+}
+
 // GetService
 InquiryService<Bond>* BondInquiryServiceConnector::GetService()
 {
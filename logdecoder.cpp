@@ -0,0 +1,174 @@
+/**
+ * logdecoder.cpp
+ * Turns the binary log written by the Logger (logger.h) back into text, one line per record:
+ *     <seconds since start> <LEVEL> T<thread> <file>:<line> <message>
+ * Records are printed in the order they were written, which is in order for each thread.
+ *
+ * Usage: logdecoder [log.bin]
+ *
+ * @author Sijia Zhang
+ */
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include "logger.h"
+
+using namespace std;
+
+const char* LOG_LEVEL_NAMES[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+
+// One argument of a record as it was logged
+struct LogArg
+{
+    char tag;
+    int64_t i;
+    uint64_t u;
+    double d;
+    std::string s;
+};
+
+// Read the arguments out of the payload of a record
+std::vector<LogArg> DecodeArgs(const LogRecord &record)
+{
+    std::vector<LogArg> args;
+    size_t pos=0;
+    for(int n=0;n<record.argCount && pos<record.size;++n){
+        LogArg arg;
+        arg.tag=record.payload[pos++];
+        arg.i=0; arg.u=0; arg.d=0;
+        if(arg.tag==LOG_ARG_STRING){
+            size_t length=static_cast<unsigned char>(record.payload[pos++]);
+            arg.s.assign(record.payload+pos, length);
+            pos+=length;
+        }
+        else{
+            if(arg.tag==LOG_ARG_INT) std::memcpy(&arg.i, record.payload+pos, 8);
+            else if(arg.tag==LOG_ARG_UINT) std::memcpy(&arg.u, record.payload+pos, 8);
+            else std::memcpy(&arg.d, record.payload+pos, 8);
+            pos+=8;
+        }
+        args.push_back(arg);
+    }
+    return args;
+}
+
+// Print one printf conversion with the argument it was given, whatever length modifier the format used
+std::string FormatArg(const std::string &flags, char conversion, const LogArg &arg)
+{
+    char buffer[256];
+    std::string spec="%"+flags;
+    if(arg.tag==LOG_ARG_STRING){
+        std::snprintf(buffer, sizeof(buffer), (spec+"s").c_str(), arg.s.c_str());
+    }
+    else if(std::strchr("feEgGaA", conversion)){
+        double value=arg.tag==LOG_ARG_DOUBLE ? arg.d : arg.tag==LOG_ARG_INT ? static_cast<double>(arg.i) : static_cast<double>(arg.u);
+        std::snprintf(buffer, sizeof(buffer), (spec+conversion).c_str(), value);
+    }
+    else if(std::strchr("di", conversion)){
+        long long value=arg.tag==LOG_ARG_INT ? arg.i : arg.tag==LOG_ARG_UINT ? static_cast<long long>(arg.u) : static_cast<long long>(arg.d);
+        std::snprintf(buffer, sizeof(buffer), (spec+"lld").c_str(), value);
+    }
+    else if(std::strchr("uoxXc", conversion)){
+        unsigned long long value=arg.tag==LOG_ARG_UINT ? arg.u : arg.tag==LOG_ARG_INT ? static_cast<unsigned long long>(arg.i) : static_cast<unsigned long long>(arg.d);
+        if(conversion=='c') std::snprintf(buffer, sizeof(buffer), (spec+"c").c_str(), static_cast<int>(value));
+        else std::snprintf(buffer, sizeof(buffer), (spec+"ll"+conversion).c_str(), value);
+    }
+    else{
+        //a string argument under a numeric conversion, or a conversion we do not know
+        return arg.tag==LOG_ARG_STRING ? arg.s : "?";
+    }
+    return buffer;
+}
+
+// Fill the format string of a site in with the arguments of a record
+std::string FormatMessage(const std::string &format, const std::vector<LogArg> &args)
+{
+    std::string message;
+    size_t next=0;
+    for(size_t i=0;i<format.size();++i){
+        if(format[i]!='%'){
+            message+=format[i];
+            continue;
+        }
+        if(i+1<format.size() && format[i+1]=='%'){
+            message+='%';
+            ++i;
+            continue;
+        }
+
+        //flags, width and precision are kept, length modifiers are dropped since every argument is 8 bytes
+        std::string flags;
+        size_t j=i+1;
+        while(j<format.size() && std::strchr("-+ #0123456789.", format[j])) flags+=format[j++];
+        while(j<format.size() && std::strchr("hlLqjzt", format[j])) ++j;
+        if(j>=format.size()) break;
+
+        //arguments cut off by the record size show up as "?"
+        message+= next<args.size() ? FormatArg(flags, format[j], args[next]) : "?";
+        ++next;
+        i=j;
+    }
+    return message;
+}
+
+int main(int argc, char* argv[]){
+    std::string path= argc>1 ? argv[1] : LOG_FILE;
+    ifstream in(path, ios::binary);
+    char magic[sizeof(LOG_MAGIC)];
+    if(!in.read(magic, sizeof(magic)) || std::memcmp(magic, LOG_MAGIC, sizeof(magic))!=0){
+        std::cout<<path<<" is not a binary log!"<<std::endl;
+        return 1;
+    }
+
+    std::vector<LogSite> sites;
+    long records=0;
+    char kind;
+    while(in.get(kind)){
+        if(kind==LOG_ENTRY_SITE){
+            uint32_t id;
+            int32_t level, line;
+            uint16_t length;
+            LogSite site;
+            in.read(reinterpret_cast<char*>(&id), sizeof(id));
+            in.read(reinterpret_cast<char*>(&level), sizeof(level));
+            in.read(reinterpret_cast<char*>(&line), sizeof(line));
+            in.read(reinterpret_cast<char*>(&length), sizeof(length));
+            site.file.resize(length);
+            in.read(&site.file[0], length);
+            in.read(reinterpret_cast<char*>(&length), sizeof(length));
+            site.format.resize(length);
+            in.read(&site.format[0], length);
+            site.level=level;
+            site.line=line;
+            if(sites.size()<=id) sites.resize(id+1);
+            sites[id]=site;
+        }
+        else if(kind==LOG_ENTRY_RECORD){
+            LogRecord record;
+            in.read(reinterpret_cast<char*>(&record), offsetof(LogRecord, payload));
+            if(record.size>LOG_PAYLOAD_SIZE || !in.read(record.payload, record.size)) break;
+            if(record.site>=sites.size()){
+                std::cout<<"record for unknown log site "<<record.site<<std::endl;
+                continue;
+            }
+
+            const LogSite& site=sites[record.site];
+            char time[32];
+            std::snprintf(time, sizeof(time), "%.9f", record.timestamp/1e9);
+            const char* level= site.level>=0 && site.level<=LOG_LEVEL_ERROR ? LOG_LEVEL_NAMES[site.level] : "?";
+            std::cout<<time<<" "<<level<<" T"<<record.thread<<" "<<site.file<<":"<<site.line<<" "
+                     <<FormatMessage(site.format, DecodeArgs(record))<<'\n';
+            ++records;
+        }
+        else{
+            std::cout<<path<<" is damaged after "<<records<<" records!"<<std::endl;
+            return 1;
+        }
+    }
+
+    std::cout.flush();
+    return 0;
+}
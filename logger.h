@@ -0,0 +1,437 @@
+/**
+ * logger.hpp
+ * Defines an asynchronous binary logger for the tracing the services do on every hop.
+ *
+ * LOG_TRACE("data goes from PositionService -> listener. (%lu positions)", count) does not format anything:
+ * the first call at a log site registers its level, file, line and format string once, and every call after
+ * that only copies the site id, a timestamp and the raw arguments into a fixed-size record on a queue owned by
+ * the calling thread. A writer thread drains the queues of all threads into a binary file, and logdecoder turns
+ * the file back into text offline. A record is dropped (and counted) rather than ever making the hot path wait.
+ *
+ * Levels below LOG_MIN_LEVEL are compiled out entirely, arguments included; build with e.g.
+ * -DLOG_MIN_LEVEL=2 to keep only info and above. The file is written to LOG_FILE.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "spscqueue.h"
+#include "cachealigned.h"
+
+using namespace std;
+
+// Levels of a log record
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+
+// Lowest level that is compiled in, everything is by default
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#endif
+
+// File the writer thread appends to
+#ifndef LOG_FILE
+#define LOG_FILE "../output/log.bin"
+#endif
+
+// Number of records each thread's queue holds
+const size_t LOG_QUEUE_CAPACITY = 1 << 14;
+
+// Bytes of arguments a record holds, strings are cut short to fit
+const size_t LOG_PAYLOAD_SIZE = 48;
+
+const char LOG_MAGIC[8] = {'T', 'S', 'B', 'I', 'N', 'L', 'O', 'G'};
+
+// Kinds of entries in the log file
+const char LOG_ENTRY_SITE = 'S';
+const char LOG_ENTRY_RECORD = 'R';
+
+// Tags of the arguments in a record
+const char LOG_ARG_INT = 'i';
+const char LOG_ARG_UINT = 'u';
+const char LOG_ARG_DOUBLE = 'd';
+const char LOG_ARG_STRING = 's';
+
+/**
+ * One call of a log macro as it goes through the queue and into the file.
+ * The arguments are stored one after another as a tag followed by 8 bytes, or for a string
+ * a tag, a length byte and the characters.
+ */
+struct LogRecord
+{
+    uint64_t timestamp;     // steady_clock nanoseconds when the record was made
+    uint32_t site;          // the log site, which gives the level and the format string
+    uint16_t thread;        // the thread that made the record, in the order threads first logged
+    uint8_t argCount;
+    uint8_t size;           // bytes of payload in use
+    char payload[LOG_PAYLOAD_SIZE];
+};
+
+/**
+ * The place in the code a record comes from.
+ */
+struct LogSite
+{
+    int level;
+    int line;
+    std::string file;
+    std::string format;
+};
+
+/**
+ * The logger of the process. Each thread gets its own queue the first time it logs.
+ */
+class Logger
+{
+
+public:
+
+    // Generate instance
+    static Logger* Generate_Instance(){
+        //we define this function to generate instance for class Logger.
+        static Logger ins;
+        return &ins;
+    }
+
+    // dtor writes what is still queued
+    ~Logger();
+
+    // Register a log site, return its id; called once per site, the arguments are only there to share the macro
+    template<typename... Args>
+    uint32_t AddSite(int level, const char *file, int line, const char *format, const Args&...);
+
+    // Queue a record for the site, the format string is already known from the site
+    template<typename... Args>
+    void Write(uint32_t site, const char *format, const Args&... args);
+
+    // Wait until every record the calling thread has queued so far is in the file
+    void Flush();
+
+    // Get the number of records dropped because the thread's queue was full
+    long GetDropCount() const;
+
+private:
+
+    // the queue of one thread
+    struct ThreadQueue : CacheAligned
+    {
+        SpscQueue<LogRecord> queue;
+        uint16_t thread;
+        uint64_t queued;                    // records queued, written by the owning thread only
+        std::atomic<uint64_t> written;      // records in the file, written by the writer thread only
+
+        explicit ThreadQueue(uint16_t _thread) : queue(LOG_QUEUE_CAPACITY), thread(_thread), queued(0), written(0) {}
+    };
+
+    // ctor starts the writer thread
+    Logger();
+
+    // a logger cannot be copied
+    Logger(const Logger &) = delete;
+    Logger& operator=(const Logger &) = delete;
+
+    // Get the queue of the calling thread, making it the first time
+    ThreadQueue* GetThreadQueue();
+
+    // Body of the writer thread
+    void Run();
+
+    // Write every site registered since the last call, then every queued record; return whether anything was written
+    bool Drain();
+
+    // Append each argument to the record
+    void Encode(LogRecord &record);
+    template<typename Arg, typename... Args>
+    void Encode(LogRecord &record, const Arg &arg, const Args&... args);
+
+    // Append one argument to the record, by kind
+    template<typename Arg>
+    void EncodeArg(LogRecord &record, const Arg &arg, std::true_type);
+    template<typename Arg>
+    void EncodeArg(LogRecord &record, const Arg &arg, std::false_type);
+    void EncodeValue(LogRecord &record, double value);
+    void EncodeValue(LogRecord &record, const char *value);
+    void EncodeValue(LogRecord &record, const std::string &value);
+    void EncodeBytes(LogRecord &record, char tag, const void *value);
+
+    std::chrono::steady_clock::time_point start;
+    std::ofstream file;
+
+    std::vector<LogSite> sites;
+    size_t sitesWritten;        // read and written by the writer thread only
+    std::mutex site_mutex;
+
+    std::vector<std::unique_ptr<ThreadQueue>> queues;
+    std::mutex queue_mutex;
+
+    std::atomic<long> dropped;
+    std::atomic<bool> running;
+    std::thread writer;
+
+};
+
+// Log at a level, a site registers itself the first time it is reached
+#define LOG_AT(level, ...) \
+    do { \
+        static const uint32_t log_site = Logger::Generate_Instance()->AddSite(level, __FILE__, __LINE__, __VA_ARGS__); \
+        Logger::Generate_Instance()->Write(log_site, __VA_ARGS__); \
+    } while (0)
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) do {} while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+
+
+//define member functions in class: Logger
+Logger::Logger() :
+        start(std::chrono::steady_clock::now()), sitesWritten(0), dropped(0), running(true)
+{
+    file.open(LOG_FILE, ios::binary | ios::trunc);
+    file.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+    writer = std::thread(&Logger::Run, this);
+}
+
+Logger::~Logger()
+{
+    running = false;
+    writer.join();
+    Drain();
+    file.flush();
+}
+
+template<typename... Args>
+uint32_t Logger::AddSite(int level, const char *file, int line, const char *format, const Args&...)
+{
+    std::lock_guard<std::mutex> lock(site_mutex);
+    LogSite site;
+    site.level = level;
+    site.line = line;
+    site.file = file;
+    site.format = format;
+    sites.push_back(site);
+    return static_cast<uint32_t>(sites.size() - 1);
+}
+
+template<typename... Args>
+void Logger::Write(uint32_t site, const char *, const Args&... args)
+{
+    ThreadQueue* tq = GetThreadQueue();
+
+    LogRecord record;
+    record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    record.site = site;
+    record.thread = tq->thread;
+    record.argCount = 0;
+    record.size = 0;
+    Encode(record, args...);
+
+    //never wait on the writer, a full queue means the record is lost
+    if (!tq->queue.TryPush(record)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ++tq->queued;
+}
+
+Logger::ThreadQueue* Logger::GetThreadQueue()
+{
+    //the queue lives as long as the logger, so the writer can still drain it after the thread has gone
+    static thread_local ThreadQueue* tq = nullptr;
+    if (!tq) {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queues.push_back(std::unique_ptr<ThreadQueue>(new ThreadQueue(static_cast<uint16_t>(queues.size()))));
+        tq = queues.back().get();
+    }
+    return tq;
+}
+
+void Logger::Flush()
+{
+    ThreadQueue* tq = GetThreadQueue();
+    while (tq->written.load(std::memory_order_acquire) < tq->queued) {
+        std::this_thread::yield();
+    }
+}
+
+long Logger::GetDropCount() const
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void Logger::Run()
+{
+    int idle = 0;
+    while (running) {
+        if (Drain()) {
+            idle = 0;
+            continue;
+        }
+
+        //yield first so a burst is picked up at once, then back off to keep an idle logger cheap
+        if (++idle < 1000) {
+            std::this_thread::yield();
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+}
+
+bool Logger::Drain()
+{
+    std::vector<ThreadQueue*> current;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (auto& q : queues) current.push_back(q.get());
+    }
+
+    bool any = false;
+    LogRecord record;
+    for (auto q : current) {
+        uint64_t count = 0;
+        while (q->queue.TryPop(record)) {
+            //a record is only queued after its site was registered, so any new site is visible by now
+            if (record.site >= sitesWritten) {
+                std::lock_guard<std::mutex> lock(site_mutex);
+                for (; sitesWritten < sites.size(); ++sitesWritten) {
+                    const LogSite& site = sites[sitesWritten];
+                    uint32_t id = static_cast<uint32_t>(sitesWritten);
+                    int32_t level = site.level, line = site.line;
+                    uint16_t fileLength = static_cast<uint16_t>(site.file.size());
+                    uint16_t formatLength = static_cast<uint16_t>(site.format.size());
+                    file.put(LOG_ENTRY_SITE);
+                    file.write(reinterpret_cast<const char*>(&id), sizeof(id));
+                    file.write(reinterpret_cast<const char*>(&level), sizeof(level));
+                    file.write(reinterpret_cast<const char*>(&line), sizeof(line));
+                    file.write(reinterpret_cast<const char*>(&fileLength), sizeof(fileLength));
+                    file.write(site.file.data(), fileLength);
+                    file.write(reinterpret_cast<const char*>(&formatLength), sizeof(formatLength));
+                    file.write(site.format.data(), formatLength);
+                }
+            }
+
+            //only the part of the payload in use goes into the file
+            file.put(LOG_ENTRY_RECORD);
+            file.write(reinterpret_cast<const char*>(&record), offsetof(LogRecord, payload) + record.size);
+            ++count;
+        }
+
+        if (count > 0) {
+            file.flush();
+            q->written.fetch_add(count, std::memory_order_release);
+            any = true;
+        }
+    }
+    return any;
+}
+
+void Logger::Encode(LogRecord &)
+{
+}
+
+template<typename Arg, typename... Args>
+void Logger::Encode(LogRecord &record, const Arg &arg, const Args&... args)
+{
+    EncodeArg(record, arg, typename std::is_integral<Arg>::type());
+    Encode(record, args...);
+}
+
+template<typename Arg>
+void Logger::EncodeArg(LogRecord &record, const Arg &arg, std::true_type)
+{
+    if (std::is_signed<Arg>::value) {
+        int64_t value = static_cast<int64_t>(arg);
+        EncodeBytes(record, LOG_ARG_INT, &value);
+    }
+    else {
+        uint64_t value = static_cast<uint64_t>(arg);
+        EncodeBytes(record, LOG_ARG_UINT, &value);
+    }
+}
+
+template<typename Arg>
+void Logger::EncodeArg(LogRecord &record, const Arg &arg, std::false_type)
+{
+    EncodeValue(record, arg);
+}
+
+void Logger::EncodeValue(LogRecord &record, double value)
+{
+    EncodeBytes(record, LOG_ARG_DOUBLE, &value);
+}
+
+void Logger::EncodeValue(LogRecord &record, const char *value)
+{
+    //a string needs its tag, its length and at least one character to be worth keeping
+    size_t room = LOG_PAYLOAD_SIZE - record.size;
+    if (room < 3) return;
+    size_t length = std::min(std::strlen(value), room - 2);
+
+    record.payload[record.size] = LOG_ARG_STRING;
+    record.payload[record.size + 1] = static_cast<char>(length);
+    std::memcpy(record.payload + record.size + 2, value, length);
+    record.size += static_cast<uint8_t>(2 + length);
+    ++record.argCount;
+}
+
+void Logger::EncodeValue(LogRecord &record, const std::string &value)
+{
+    EncodeValue(record, value.c_str());
+}
+
+void Logger::EncodeBytes(LogRecord &record, char tag, const void *value)
+{
+    //arguments that do not fit are left out, the decoder prints what is missing as "?"
+    if (static_cast<size_t>(record.size) + 1 + 8 > LOG_PAYLOAD_SIZE) return;
+
+    record.payload[record.size] = tag;
+    std::memcpy(record.payload + record.size + 1, value, 8);
+    record.size += 9;
+    ++record.argCount;
+}
+
+#endif
@@ -13,13 +13,21 @@
 #include <fstream>
 #include <sstream>
 #include "soa.h"
+#include "productindexedstore.h"
 #include "products.h"
+#include "csvreader.h"
+#include "pricetick.h"
+#include "binaryformat.h"
+#include "shmring.h"
 
 using namespace std;
 
 // Side for market data
 enum PricingSide { BID, OFFER };
 
+// The tightest bid/offer spread quoted, 1/128
+const TickPrice MINIMUM_SPREAD(TICKS_PER_POINT / 128);
+
 /**
  * A market data order with price, quantity, and side.
  */
@@ -32,10 +40,10 @@ public:
     Order(){};
 
     // ctor for an order
-    Order(double _price, long _quantity, PricingSide _side);
+    Order(TickPrice _price, long _quantity, PricingSide _side);
 
     // Get the price on the order
-    double GetPrice() const;
+    TickPrice GetPrice() const;
 
     // Get the quantity on the order
     long GetQuantity() const;
@@ -44,7 +52,7 @@ public:
     PricingSide GetSide() const;
 
 private:
-    double price;
+    TickPrice price;
     long quantity;
     PricingSide side;
 
@@ -85,7 +93,7 @@ class OrderBook
 public:
 
     //ctor
-    OrderBook(){};
+    OrderBook() : productId(NO_PRODUCT) {};
 
     // ctor for the order book
     OrderBook(const T &_product, const vector<Order> &_bidStack, const vector<Order> &_offerStack);
@@ -116,7 +124,7 @@ public:
     }
 
 private:
-    T product;
+    ProductId productId;    // the product, interned in ProductTable<T>
     vector<Order> bidStack;
     vector<Order> offerStack;
 
@@ -137,8 +145,8 @@ private:
     //define listener
     std::vector<ServiceListener<OrderBook<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, OrderBook<Bond>> market_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<OrderBook<Bond>> market_data;
 
     //ctor
     MarketDataService(){};
@@ -159,6 +167,9 @@ public:
     // The callback that a Connector should invoke for any new or updated data
     void OnMessage(OrderBook<Bond> &data) ;
 
+    // Store the order book without notifying listeners, return the order book to pass on
+    OrderBook<Bond>& ApplyOrderBook(OrderBook<Bond> &data);
+
     // Add a listener to the Service for callbacks on add, remove, and update events
     // for data to the Service.
     void AddListener(ServiceListener<OrderBook<Bond>> *listener) ;
@@ -188,6 +199,12 @@ private:
     MarketDataService* market_data_service;
     BondProductService* bond_product_service;
 
+    //lines read and skipped in the last file subscribed
+    ParseStats stats;
+
+    //time from each update being written into the ring to OnMessage returning, for SubscribeShm
+    LatencyStats latency;
+
 public:
 
     // ctor
@@ -210,6 +227,21 @@ public:
     // It is used for reading data from file via OnMessage Method
     void Subscribe();
 
+    // SubscribeBinary
+    // It is used for reading data from a binary columnar file (see binaryformat.h) via OnMessage Method
+    void SubscribeBinary(const std::string &path = "../input/marketdata.bin");
+
+    // SubscribeShm
+    // It is used for reading book updates from the shared memory ring a feed handler writes to (see shmring.h)
+    // via OnMessage Method, until the feed closes the ring. It waits up to timeoutMs for the feed to create the ring
+    void SubscribeShm(const std::string &name = SHM_RING_DEFAULT_NAME, long timeoutMs = 10000);
+
+    // Get the counts of lines read and skipped in the last file subscribed
+    const ParseStats& GetParseStats() const;
+
+    // Get the tick-to-OnMessage latency of the last SubscribeShm
+    const LatencyStats& GetLatencyStats() const;
+
     // GetService
     MarketDataService* GetService();
 };
@@ -217,14 +249,14 @@ public:
 
 
 //define member functions in class: Order
-Order::Order(double _price, long _quantity, PricingSide _side)
+Order::Order(TickPrice _price, long _quantity, PricingSide _side)
 {
     price = _price;
     quantity = _quantity;
     side = _side;
 }
 
-double Order::GetPrice() const
+TickPrice Order::GetPrice() const
 {
     return price;
 }
@@ -260,14 +292,14 @@ const Order& BidOffer::GetOfferOrder() const
 //define member fuctions in class: OrderBook
 template<typename T>
 OrderBook<T>::OrderBook(const T &_product, const vector<Order> &_bidStack, const vector<Order> &_offerStack) :
-        product(_product), bidStack(_bidStack), offerStack(_offerStack)
+        productId(ProductTable<T>::Generate_Instance()->Intern(_product)), bidStack(_bidStack), offerStack(_offerStack)
 {
 }
 
 template<typename T>
 const T& OrderBook<T>::GetProduct() const
 {
-    return product;
+    return ProductTable<T>::Generate_Instance()->Get(productId);
 }
 
 template<typename T>
@@ -286,17 +318,23 @@ const vector<Order>& OrderBook<T>::GetOfferStack() const
 //define member functions in class: MarketDataService
 OrderBook<Bond>& MarketDataService::GetData(std::string key) 
 {
-    return market_data.at(key);
+    return market_data.At(key);
+}
+
+OrderBook<Bond>& MarketDataService::ApplyOrderBook(OrderBook<Bond> &data)
+{
+    //store the newly or updated data
+    market_data.Insert(data.GetProduct().GetId(),data);
+    return data;
 }
 
 void MarketDataService::OnMessage(OrderBook<Bond> &data) 
 {
     //firstly, store the newly or updated data
-    auto key=data.GetProduct().GetProductId(); //get key
-    market_data.insert(std::make_pair(key,data));
+    ApplyOrderBook(data);
 
     //then, pass the updated data to listener
-    std::cout<<"data goes from MarketDataService -> listener."<<std::endl;
+    LOG_TRACE("data goes from MarketDataService -> listener.");
     for(auto& l:listeners){
         l->ProcessAdd(data);
     }
@@ -315,11 +353,11 @@ const std::vector< ServiceListener<OrderBook<Bond>>* >& MarketDataService::GetLi
 const BidOffer& MarketDataService::GetBestBidOffer(const string &productId)
 {
     int index=0;
-    auto& md=market_data.at(productId);
+    auto& md=market_data.At(productId);
 
     //using loop to find the bid and offer with minimum spread: 1/128
     for(int i=0;i<md.GetBidStack().size();i++){
-        if(md.GetOfferStack()[i].GetPrice()-md.GetBidStack()[i].GetPrice()==1/128.){
+        if(md.GetOfferStack()[i].GetPrice()-md.GetBidStack()[i].GetPrice()==MINIMUM_SPREAD){
             index=i;
         }
     }
@@ -330,7 +368,7 @@ const BidOffer& MarketDataService::GetBestBidOffer(const string &productId)
 
 const OrderBook<Bond>& MarketDataService::AggregateDepth(const string &productId)
 {
-    auto& md=market_data.at(productId);
+    auto& md=market_data.At(productId);
     const OrderBook<Bond> & s = OrderBook<Bond>(md.GetProduct(),md.GetBidStack(),md.GetOfferStack());
     return s;
 }
@@ -345,103 +383,232 @@ void MarketDataConnector::Publish(OrderBook<Bond>& data)
 
 //********************************************************
 void MarketDataConnector::Subscribe() {
-    //define some strings we will use later
-    std::string key, price, quantity;
-    std::vector<Order> bid_container, offer_container;
+    //map the file and do subscribing
+    stats=ParseStats("input/marketdata.txt");
+    MappedFile file("../input/marketdata.txt");
+    if(!file.IsOpen()){
+        std::cout<<"input/marketdata.txt cannot be opened!"<<std::endl;
+        return;
+    }
 
-    //lambda function working to split one line and return vector of parts
-    auto splitoneline = [](std::string line){
-        stringstream ss(line);
-        std::string part; //define each part in the line
-        std::vector<std::string> container; //define container to contain each part and return it
+    CsvLineReader reader(file.Begin(), file.End());
+    reader.NextLine(); //skip the header
 
-        while(getline(ss,part,',')){
-            container.push_back(part); //using comma as our separate signal
+    //each line holds a CUSIP followed by 5 bid and 5 offer (price, quantity) pairs
+    const size_t field_count=21;
+    boost::string_view fields[field_count];
+
+    //the containers are reused for every line so that they only allocate once
+    std::vector<Order> bid_container, offer_container;
+    bid_container.reserve(5);
+    offer_container.reserve(5);
+
+    //the 10 prices of a line are converted to ticks in one go, next to the 10 quantities
+    boost::string_view prices[10];
+    int64_t ticks[10];
+    long quantities[10];
+
+    //the fields point into the mapping, so we can cache the bond of each CUSIP without copying the key
+    std::map<boost::string_view, const Bond*> bond_cache;
+    boost::string_view last_key;
+    const Bond* bond=nullptr;
+
+    while(reader.NextLine()){
+        if(reader.GetLine().empty()){
+            continue;
         }
 
-        return container;
-    };
+        //parse the whole line before touching the bond, bad lines are skipped and counted
+        ParseErrc ec=PARSE_OK;
+        if(reader.Split(fields, field_count)<field_count){
+            ec=PARSE_MISSING_FIELDS;
+        }
+        else if(fields[0].empty()){
+            ec=PARSE_EMPTY_FIELD;
+        }
+        else{
+            //gather the price column of the line, prices sit on the odd fields
+            for(size_t i=0;i<10;++i){
+                prices[i]=fields[2*i+1];
+            }
+            ec=ParsePriceColumn(prices, 10, ticks);
+            for(size_t i=0;i<10 && ec==PARSE_OK;++i){
+                ec=ParseLong(fields[2*i+2], quantities[i]).ec;
+            }
+        }
+        stats.CountLine(ec);
+        if(ec!=PARSE_OK){
+            continue;
+        }
 
-    //lambda function working to transposing price of the bond
-    auto PriceTranspose = [](std::string s){
-        size_t pos=s.find_first_of('-'); //position of the '-'
+        //find the bond in order to define OrderBook, lines of the same CUSIP come together
+        if(bond==nullptr || fields[0]!=last_key){
+            auto it=bond_cache.find(fields[0]);
+            if(it==bond_cache.end()){
+                it=bond_cache.insert(std::make_pair(fields[0], &bond_product_service->GetData(std::string(fields[0].data(), fields[0].size())))).first;
+            }
+            last_key=fields[0];
+            bond=it->second;
+        }
 
-        //we use std::stoi to transpose string to double
-        //firstly, calculate the value of the first part before pos '-'
-        double value=std::stoi(s.substr(0,pos));
+        bid_container.clear();
+        offer_container.clear();
 
-        //then, calculate the first value after '-', 2 char in the string
-        int temp1=std::stoi(s.substr(pos+1,2));
+        //get price and quantity and define order
+        //Bid
+        for(size_t i=0;i<5;++i){
+            Order o_bid(TickPrice(ticks[i]),quantities[i],BID);
+            bid_container.push_back(o_bid);
+        }
 
-        //at the same time, calculate the last value in s
-        auto last=s[s.size()-1];
-        if(last=='+'){
-            last='4';
+        //Offer
+        for(size_t i=5;i<10;++i){
+            Order o_offer(TickPrice(ticks[i]),quantities[i],OFFER);
+            offer_container.push_back(o_offer);
         }
-        int temp2=last-'0';
 
-        //finally, add them up and get the final value
-        double final_value=value+(temp1/32.+temp2/256.);
-        return final_value;
-    };
+        //define OrderBook
+        OrderBook<Bond> orderbook(*bond, bid_container, offer_container);
+
+        //using OnMessage to pass the data to MarketDataService
+        market_data_service->OnMessage(orderbook);
+    }
 
-    //read the file and do subscribing
-    ifstream iss("../input/marketdata.txt");
-    std::string line;
-    getline(iss,line);
+    std::cout<<stats<<std::endl;
+    std::cout<<"input/marketdata.txt -> MarketDataService DONE!"<<std::endl;
+}
+//****************************************************************************
 
-    for(int i=0;i<60;i++){
-        getline(iss, line);
-        //create a vector to contain the parts in each line
-        std::vector<std::string> container=splitoneline(line);
+void MarketDataConnector::SubscribeBinary(const std::string &path)
+{
+    //map the file and check it holds order books
+    BinaryColumnFile file(path);
+    if(!file.IsValid() || file.GetRecordType()!=MARKET_DATA_RECORDS){
+        std::cout<<path<<" is not a binary market data file!"<<std::endl;
+        return;
+    }
 
-        //using the string defined above as the name of different parts
-        key=container[0];
-        int index=1; //define an index in order to get position of quantity and bid/offer price
+    //resolve every product of the file to its bond once
+    std::vector<const Bond*> bonds;
+    for(size_t i=0;i<file.GetProductCount();++i){
+        bonds.push_back(&bond_product_service->GetData(file.GetProductId(i)));
+    }
 
-        //get price and quantity and define order
-        //Bid
-        for(int i=1;i<=5;++i){
-            //get price
-            price=container[index++];
+    const uint32_t* product=file.GetProductColumn();
+    const int64_t* bid_price[BOOK_DEPTH];
+    const int64_t* bid_quantity[BOOK_DEPTH];
+    const int64_t* offer_price[BOOK_DEPTH];
+    const int64_t* offer_quantity[BOOK_DEPTH];
+    for(int level=0;level<BOOK_DEPTH;++level){
+        bid_price[level]=file.GetColumn(MD_BID_PRICE+level);
+        bid_quantity[level]=file.GetColumn(MD_BID_QUANTITY+level);
+        offer_price[level]=file.GetColumn(MD_OFFER_PRICE+level);
+        offer_quantity[level]=file.GetColumn(MD_OFFER_QUANTITY+level);
+    }
 
-            //get quantity
-            quantity=container[index++];
+    std::vector<Order> bid_container, offer_container;
+    bid_container.reserve(BOOK_DEPTH);
+    offer_container.reserve(BOOK_DEPTH);
+
+    stats=ParseStats(path);
+    for(size_t row=0;row<file.GetRowCount();++row){
+        //a row pointing past the product table is skipped and counted, as a bad csv line is
+        if(product[row]>=bonds.size()){
+            stats.CountLine(PARSE_OUT_OF_RANGE);
+            continue;
+        }
+        stats.CountLine(PARSE_OK);
 
-            //define order
-            Order o_bid(PriceTranspose(price),std::stol(quantity),BID);
+        bid_container.clear();
+        offer_container.clear();
 
-            //push all bids in the bid_container
-            bid_container.push_back(o_bid);
+        for(int level=0;level<BOOK_DEPTH;++level){
+            bid_container.push_back(Order(TickPrice(bid_price[level][row]),bid_quantity[level][row],BID));
+            offer_container.push_back(Order(TickPrice(offer_price[level][row]),offer_quantity[level][row],OFFER));
         }
 
-        //Offer
-        for(int i=1;i<=5;++i){
-            //get price
-            price=container[index++];
+        //define OrderBook and pass it to MarketDataService
+        OrderBook<Bond> orderbook(*bonds[product[row]], bid_container, offer_container);
+        market_data_service->OnMessage(orderbook);
+    }
 
-            //get quantity
-            quantity=container[index++];
+    std::cout<<stats<<std::endl;
+    std::cout<<path<<" -> MarketDataService DONE!"<<std::endl;
+}
 
-            //define order
-            Order o_offer(PriceTranspose(price),std::stol(quantity),OFFER);
-            //push all bids in the bid_container
-            offer_container.push_back(o_offer);
+void MarketDataConnector::SubscribeShm(const std::string &name, long timeoutMs)
+{
+    //attach to the ring the feed handler writes to
+    ShmRing<BookUpdate> ring;
+    if(!ring.Open(name, timeoutMs)){
+        std::cout<<name<<" is not a book update ring!"<<std::endl;
+        return;
+    }
+    latency.Reset();
+
+    //the bond of each CUSIP is resolved once, updates of the same CUSIP usually come together
+    std::map<std::string, const Bond*> bond_cache;
+    char last_key[PRODUCT_ID_WIDTH]={0};
+    const Bond* bond=nullptr;
+
+    std::vector<Order> bid_container, offer_container;
+    bid_container.reserve(BOOK_DEPTH);
+    offer_container.reserve(BOOK_DEPTH);
+
+    BookUpdate update;
+    while(true){
+        if(!ring.TryPop(update)){
+            if(!ring.IsClosed()){
+                std::this_thread::yield();
+                continue;
+            }
+            //the feed closes the ring after its last update, so look once more: an update pushed just before
+            //the close is handled like any other, and an empty closed ring is the end
+            if(!ring.TryPop(update)){
+                break;
+            }
         }
 
-        //define OrderBook
         //find the bond in order to define OrderBook
-        auto bond=bond_product_service->GetData(key);
+        if(bond==nullptr || memcmp(update.product, last_key, PRODUCT_ID_WIDTH)!=0){
+            std::string key(update.product, strnlen(update.product, PRODUCT_ID_WIDTH));
+            auto it=bond_cache.find(key);
+            if(it==bond_cache.end()){
+                it=bond_cache.insert(std::make_pair(key, &bond_product_service->GetData(key))).first;
+            }
+            memcpy(last_key, update.product, PRODUCT_ID_WIDTH);
+            bond=it->second;
+        }
 
-        OrderBook<Bond> orderbook(bond, bid_container, offer_container);
+        bid_container.clear();
+        offer_container.clear();
+        for(int level=0;level<BOOK_DEPTH;++level){
+            bid_container.push_back(Order(TickPrice(update.bidPrice[level]),update.bidQuantity[level],BID));
+            offer_container.push_back(Order(TickPrice(update.offerPrice[level]),update.offerQuantity[level],OFFER));
+        }
 
-        //using OnMessage to pass the data to MarketDataService
+        //define OrderBook and pass it to MarketDataService, the latency covers the whole listener chain
+        OrderBook<Bond> orderbook(*bond, bid_container, offer_container);
         market_data_service->OnMessage(orderbook);
+        latency.Add(SteadyNanoseconds()-update.timestamp);
     }
 
-    std::cout<<"input/marketdata.txt -> MarketDataService DONE!"<<std::endl;
+    //the feed is finished with the ring, so take it out of /dev/shm
+    ShmRing<BookUpdate>::Remove(name);
+
+    std::cout<<name<<" tick-to-OnMessage latency: "<<latency<<std::endl;
+    std::cout<<name<<" -> MarketDataService DONE!"<<std::endl;
+}
+
+const ParseStats& MarketDataConnector::GetParseStats() const
+{
+    return stats;
+}
+
+const LatencyStats& MarketDataConnector::GetLatencyStats() const
+{
+    return latency;
 }
-//****************************************************************************
 
 // GetService
 MarketDataService* MarketDataConnector::GetService()
@@ -0,0 +1,346 @@
+/**
+ * messagesocket.hpp
+ * Defines the length-prefixed binary messages an order management system pushes over a Unix domain socket,
+ * the listening side used by the connectors and the sending side used by ordersender.
+ *
+ * Every message is a MessageHeader followed by length bytes of payload. Both ends run on the same host,
+ * so integers are in host byte order. The reader drains as much as the socket holds with one recv and
+ * hands out every complete message in the buffer before reading again.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef MESSAGE_SOCKET_HPP
+#define MESSAGE_SOCKET_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Sockets the connectors listen on by default
+const char TRADE_SOCKET_PATH[] = "/tmp/trading_system_trades.sock";
+const char INQUIRY_SOCKET_PATH[] = "/tmp/trading_system_inquiries.sock";
+
+// The message types
+enum MessageType { TRADE_MESSAGE = 1, INQUIRY_MESSAGE = 2 };
+
+// Width of the text fields of a message, padded with '\0'
+const size_t MESSAGE_ID_WIDTH = 16;
+
+/**
+ * Header in front of every message.
+ */
+struct MessageHeader
+{
+    uint32_t length;    // bytes of payload after the header
+    uint32_t type;      // a MessageType
+};
+
+/**
+ * Payload of a TRADE_MESSAGE, the price is in 1/256 ticks and side is a Side.
+ */
+struct TradeMessage
+{
+    char product[MESSAGE_ID_WIDTH];
+    char tradeId[MESSAGE_ID_WIDTH];
+    char book[MESSAGE_ID_WIDTH];
+    int64_t price;
+    int64_t quantity;
+    uint32_t side;
+    uint32_t reserved;
+};
+
+/**
+ * Payload of an INQUIRY_MESSAGE, the price is in 1/256 ticks, side is a Side and state an InquiryState.
+ */
+struct InquiryMessage
+{
+    char product[MESSAGE_ID_WIDTH];
+    char inquiryId[MESSAGE_ID_WIDTH];
+    int64_t price;
+    int64_t quantity;
+    uint32_t side;
+    uint32_t state;
+};
+
+/**
+ * Listening end of a Unix domain socket, it accepts one sender and drains its messages.
+ */
+class MessageSocketReader
+{
+
+public:
+
+    // ctor for a reader that is not listening yet
+    MessageSocketReader();
+
+    // dtor closes the sockets and removes the socket file
+    ~MessageSocketReader();
+
+    // Listen on the socket file at path, a stale socket file is replaced
+    bool Listen(const std::string &path);
+
+    // Wait for a sender to connect
+    bool Accept();
+
+    // Read whatever the sender has written with one recv, return false once the sender has closed
+    bool Drain();
+
+    // Get the next complete message read by the last Drain, return false when there is none left
+    // A message too large for the buffer is skipped and handed out once with type 0 and no payload
+    bool Next(MessageHeader &header, const char *&payload);
+
+    // Get the number of Drain calls that read data
+    long GetDrains() const;
+
+private:
+
+    // a socket cannot be copied
+    MessageSocketReader(const MessageSocketReader &) = delete;
+    MessageSocketReader& operator=(const MessageSocketReader &) = delete;
+
+    static const size_t BUFFER_SIZE = 1 << 18;
+
+    std::string path;
+    int listener;
+    int connection;
+    std::vector<char> buffer;
+    size_t begin;   // first byte not handed out yet
+    size_t end;     // one past the last byte read
+    size_t skip;    // bytes still to throw away of a message too large for the buffer
+    long drains;
+
+};
+
+/**
+ * Sending end of a Unix domain socket, messages are collected in a buffer and written in large blocks.
+ */
+class MessageSocketWriter
+{
+
+public:
+
+    // ctor for a writer that is not connected yet
+    MessageSocketWriter();
+
+    // dtor flushes and closes the socket
+    ~MessageSocketWriter();
+
+    // Connect to the socket file at path
+    bool Connect(const std::string &path);
+
+    // Queue one message, the buffer is written out when it is full
+    bool Send(MessageType type, const void *payload, uint32_t length);
+
+    // Write out everything queued
+    bool Flush();
+
+private:
+
+    // a socket cannot be copied
+    MessageSocketWriter(const MessageSocketWriter &) = delete;
+    MessageSocketWriter& operator=(const MessageSocketWriter &) = delete;
+
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    int fd;
+    std::vector<char> buffer;
+    size_t used;
+
+};
+
+// Copy a string into a fixed width message field, padding with '\0' and cutting what does not fit
+void SetMessageField(char *field, const char *s, size_t n);
+
+// Get the text of a fixed width message field
+std::string GetMessageField(const char *field);
+
+
+
+//define member functions in class: MessageSocketReader
+MessageSocketReader::MessageSocketReader() :
+        listener(-1), connection(-1), buffer(BUFFER_SIZE), begin(0), end(0), skip(0), drains(0)
+{
+}
+
+MessageSocketReader::~MessageSocketReader()
+{
+    if (connection >= 0) close(connection);
+    if (listener >= 0) {
+        close(listener);
+        unlink(path.c_str());
+    }
+}
+
+bool MessageSocketReader::Listen(const std::string &_path)
+{
+    struct sockaddr_un address;
+    if (_path.size() >= sizeof(address.sun_path)) return false;
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) return false;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, _path.data(), _path.size());
+
+    //a socket file left by an earlier run would make bind fail
+    unlink(_path.c_str());
+    if (bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 1) != 0) {
+        close(listener);
+        listener = -1;
+        return false;
+    }
+
+    path = _path;
+    return true;
+}
+
+bool MessageSocketReader::Accept()
+{
+    do {
+        connection = accept(listener, nullptr, nullptr);
+    } while (connection < 0 && errno == EINTR);
+
+    begin = end = skip = 0;
+    drains = 0;
+    return connection >= 0;
+}
+
+bool MessageSocketReader::Drain()
+{
+    //keep the unfinished message at the front and fill the rest of the buffer
+    if (begin > 0) {
+        memmove(&buffer[0], &buffer[begin], end - begin);
+        end -= begin;
+        begin = 0;
+    }
+
+    ssize_t n;
+    do {
+        n = recv(connection, &buffer[end], buffer.size() - end, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return false;
+
+    end += n;
+    ++drains;
+    return true;
+}
+
+bool MessageSocketReader::Next(MessageHeader &header, const char *&payload)
+{
+    //throw away what has arrived of a message too large for the buffer
+    if (skip > 0) {
+        size_t n = std::min(skip, end - begin);
+        begin += n;
+        skip -= n;
+        if (skip > 0) return false;
+    }
+
+    if (end - begin < sizeof(MessageHeader)) return false;
+    memcpy(&header, &buffer[begin], sizeof(MessageHeader));
+
+    //a message larger than the buffer can never complete, so it is dropped as it arrives
+    if (header.length > buffer.size() - sizeof(MessageHeader)) {
+        skip = sizeof(MessageHeader) + header.length;
+        size_t n = std::min(skip, end - begin);
+        begin += n;
+        skip -= n;
+        header.type = 0;
+        header.length = 0;
+        payload = nullptr;
+        return true;
+    }
+
+    if (end - begin < sizeof(MessageHeader) + header.length) return false;
+    payload = &buffer[begin + sizeof(MessageHeader)];
+    begin += sizeof(MessageHeader) + header.length;
+    return true;
+}
+
+long MessageSocketReader::GetDrains() const
+{
+    return drains;
+}
+
+
+
+//define member functions in class: MessageSocketWriter
+MessageSocketWriter::MessageSocketWriter() :
+        fd(-1), buffer(BUFFER_SIZE), used(0)
+{
+}
+
+MessageSocketWriter::~MessageSocketWriter()
+{
+    Flush();
+    if (fd >= 0) close(fd);
+}
+
+bool MessageSocketWriter::Connect(const std::string &path)
+{
+    struct sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path)) return false;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.data(), path.size());
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool MessageSocketWriter::Send(MessageType type, const void *payload, uint32_t length)
+{
+    if (sizeof(MessageHeader) + length > buffer.size()) return false;
+    if (used + sizeof(MessageHeader) + length > buffer.size() && !Flush()) return false;
+
+    MessageHeader header = {length, static_cast<uint32_t>(type)};
+    memcpy(&buffer[used], &header, sizeof(header));
+    memcpy(&buffer[used + sizeof(header)], payload, length);
+    used += sizeof(header) + length;
+    return true;
+}
+
+bool MessageSocketWriter::Flush()
+{
+    size_t written = 0;
+    while (fd >= 0 && written < used) {
+        ssize_t n = send(fd, &buffer[written], used - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += static_cast<size_t>(n);
+    }
+
+    bool ok = (written == used);
+    used = 0;
+    return ok;
+}
+
+
+
+void SetMessageField(char *field, const char *s, size_t n)
+{
+    memset(field, 0, MESSAGE_ID_WIDTH);
+    memcpy(field, s, n < MESSAGE_ID_WIDTH ? n : MESSAGE_ID_WIDTH);
+}
+
+std::string GetMessageField(const char *field)
+{
+    return std::string(field, strnlen(field, MESSAGE_ID_WIDTH));
+}
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ * multicastring.hpp
+ * Defines a ring buffer with one producer and several consumers that each see every item,
+ * in the style of a disruptor: the producer publishes a sequence number, every consumer
+ * keeps its own cursor and the producer only waits for the slowest of them when the ring is full.
+ *
+ * A consumer reads the items in place and releases them when it is done, so one consumer
+ * falling behind never holds back another one until the ring is full.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef MULTICAST_RING_HPP
+#define MULTICAST_RING_HPP
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include "cachealigned.h"
+
+using namespace std;
+
+// Number of slots of a ring by default
+const size_t MULTICAST_RING_DEFAULT_CAPACITY = 1 << 14;
+
+// Most consumers a ring can have
+const size_t MULTICAST_RING_MAX_CONSUMERS = 8;
+
+/**
+ * A ring of items of type T with one producer thread and up to MULTICAST_RING_MAX_CONSUMERS consumer threads.
+ * Every consumer must be added before the first item is published.
+ */
+template<typename T>
+class MulticastRing : public CacheAligned
+{
+
+public:
+
+    // ctor for a ring of at least capacity slots, rounded up to a power of 2
+    explicit MulticastRing(size_t capacity = MULTICAST_RING_DEFAULT_CAPACITY);
+
+    // Add a consumer starting at the first item, return its id or -1 if there are too many
+    int AddConsumer();
+
+    // Get the number of consumers
+    size_t GetConsumerCount() const;
+
+    // Get the number of slots
+    size_t GetCapacity() const;
+
+    // Publish a copy of item, waiting while the slowest consumer is a whole ring behind (producer only)
+    void Publish(const T &item);
+
+    // Get the number of items published so far, items 0 to GetPublished()-1 can be read
+    uint64_t GetPublished() const;
+
+    // Get the item with sequence number seq, it stays valid until the consumer releases it
+    const T& Get(uint64_t seq) const;
+
+    // Mark that the consumer is done with every item before seq
+    void Release(int consumer, uint64_t seq);
+
+    // Mark that the producer will not publish any more items
+    void Close();
+
+    // Whether the producer has closed the ring
+    bool IsClosed() const;
+
+    // Get the number of times the producer found the ring full and had to wait
+    long GetFullCount() const;
+
+private:
+
+    // a ring cannot be copied
+    MulticastRing(const MulticastRing &) = delete;
+    MulticastRing& operator=(const MulticastRing &) = delete;
+
+    // Get the cursor of the slowest consumer
+    uint64_t SlowestConsumer() const;
+
+    // a cursor on its own cache line
+    struct alignas(64) Cursor
+    {
+        std::atomic<uint64_t> value;
+    };
+
+    std::vector<T> slots;
+    uint64_t mask;
+    alignas(64) std::atomic<uint64_t> published;    // written by the producer only
+    uint64_t cachedGate;                            // the producer's copy of the slowest consumer
+    long full;
+    Cursor cursors[MULTICAST_RING_MAX_CONSUMERS];   // each written by its consumer only
+    size_t consumerCount;
+    alignas(64) std::atomic<bool> closed;
+
+};
+
+
+
+//define member functions in class: MulticastRing
+template<typename T>
+MulticastRing<T>::MulticastRing(size_t capacity) :
+        published(0), cachedGate(0), full(0), consumerCount(0), closed(false)
+{
+    size_t slotCount = 1;
+    while (slotCount < capacity) slotCount <<= 1;
+    slots.resize(slotCount);
+    mask = slotCount - 1;
+
+    for (size_t i = 0; i < MULTICAST_RING_MAX_CONSUMERS; ++i) {
+        cursors[i].value.store(0, std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+int MulticastRing<T>::AddConsumer()
+{
+    if (consumerCount == MULTICAST_RING_MAX_CONSUMERS) return -1;
+    return static_cast<int>(consumerCount++);
+}
+
+template<typename T>
+size_t MulticastRing<T>::GetConsumerCount() const
+{
+    return consumerCount;
+}
+
+template<typename T>
+size_t MulticastRing<T>::GetCapacity() const
+{
+    return mask + 1;
+}
+
+template<typename T>
+uint64_t MulticastRing<T>::SlowestConsumer() const
+{
+    //with no consumer nothing holds the producer back
+    uint64_t slowest = published.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < consumerCount; ++i) {
+        uint64_t cursor = cursors[i].value.load(std::memory_order_acquire);
+        if (cursor < slowest) slowest = cursor;
+    }
+    return slowest;
+}
+
+template<typename T>
+void MulticastRing<T>::Publish(const T &item)
+{
+    uint64_t seq = published.load(std::memory_order_relaxed);
+    if (seq - cachedGate > mask) {
+        //only look at the consumers' cursors when our copy says the ring is full
+        cachedGate = SlowestConsumer();
+        if (seq - cachedGate > mask) {
+            ++full;
+            do {
+                std::this_thread::yield();
+                cachedGate = SlowestConsumer();
+            } while (seq - cachedGate > mask);
+        }
+    }
+
+    slots[seq & mask] = item;
+    published.store(seq + 1, std::memory_order_release);
+}
+
+template<typename T>
+uint64_t MulticastRing<T>::GetPublished() const
+{
+    return published.load(std::memory_order_acquire);
+}
+
+template<typename T>
+const T& MulticastRing<T>::Get(uint64_t seq) const
+{
+    return slots[seq & mask];
+}
+
+template<typename T>
+void MulticastRing<T>::Release(int consumer, uint64_t seq)
+{
+    cursors[consumer].value.store(seq, std::memory_order_release);
+}
+
+template<typename T>
+void MulticastRing<T>::Close()
+{
+    closed.store(true, std::memory_order_release);
+}
+
+template<typename T>
+bool MulticastRing<T>::IsClosed() const
+{
+    return closed.load(std::memory_order_acquire);
+}
+
+template<typename T>
+long MulticastRing<T>::GetFullCount() const
+{
+    return full;
+}
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ * ordersender.cpp
+ * Plays the upstream order management system: replays trades.txt or inquiries.txt as binary messages
+ * over the Unix domain socket read by TradeBookingConnector::SubscribeSocket or
+ * BondInquiryServiceConnector::SubscribeSocket.
+ *
+ * Usage: ordersender trades|inquiries [--file PATH] [--socket PATH] [--repeat N]
+ *
+ * @author Sijia Zhang
+ */
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "products.h"
+#include "tradebookingservice.h"
+#include "inquiryservice.h"
+#include "messagesocket.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]){
+    if(argc<2){
+        std::cout<<"Usage: "<<argv[0]<<" trades|inquiries [--file PATH] [--socket PATH] [--repeat N]"<<std::endl;
+        return 1;
+    }
+
+    //pick the message type and the default paths used by the connectors
+    std::string kind=argv[1];
+    std::string file, socket;
+    if(kind=="trades"){
+        file="../input/trades.txt";
+        socket=TRADE_SOCKET_PATH;
+    }
+    else if(kind=="inquiries"){
+        file="../input/inquiries.txt";
+        socket=INQUIRY_SOCKET_PATH;
+    }
+    else{
+        std::cout<<"Unknown message kind: "<<kind<<std::endl;
+        return 1;
+    }
+
+    long repeat=1;
+    for(int i=2;i+1<argc;i+=2){
+        std::string option=argv[i], value=argv[i+1];
+        if(option=="--file") file=value;
+        else if(option=="--socket") socket=value;
+        else if(option=="--repeat") repeat=std::stol(value);
+        else{
+            std::cout<<"Unknown option: "<<option<<std::endl;
+            return 1;
+        }
+    }
+
+    MappedFile input(file);
+    if(!input.IsOpen()){
+        std::cout<<file<<" cannot be opened!"<<std::endl;
+        return 1;
+    }
+
+    MessageSocketWriter writer;
+    if(!writer.Connect(socket)){
+        std::cout<<socket<<" cannot be connected to!"<<std::endl;
+        return 1;
+    }
+
+    ParseStats stats(file);
+    boost::string_view fields[6];
+    long sent=0;
+
+    auto start=std::chrono::steady_clock::now();
+    for(long r=0;r<repeat;++r){
+        CsvLineReader reader(input.Begin(), input.End());
+        reader.NextLine(); //skip the header
+
+        while(reader.NextLine()){
+            if(reader.GetLine().empty()){
+                continue;
+            }
+
+            //the lines are parsed the same way the file connectors parse them
+            ParseErrc ec=PARSE_OK;
+            bool ok=true;
+            if(kind=="trades"){
+                //CUSIP, trade id, book, price, quantity and side
+                TradeMessage message;
+                memset(&message, 0, sizeof(message));
+                long quantity=0;
+                Side side=BUY;
+                if(reader.Split(fields, 6)<6){
+                    ec=PARSE_MISSING_FIELDS;
+                }
+                else{
+                    ParseResult result=ParsePriceTicks(fields[3], message.price);
+                    if(result.ec==PARSE_OK) result=ParseLong(fields[4], quantity);
+                    if(result.ec==PARSE_OK) result=ParseSide(fields[5], side);
+                    ec=result.ec;
+                }
+                if(ec==PARSE_OK){
+                    SetMessageField(message.product, fields[0].data(), fields[0].size());
+                    SetMessageField(message.tradeId, fields[1].data(), fields[1].size());
+                    SetMessageField(message.book, fields[2].data(), fields[2].size());
+                    message.quantity=quantity;
+                    message.side=side;
+                    ok=writer.Send(TRADE_MESSAGE, &message, sizeof(message));
+                }
+            }
+            else{
+                //CUSIP, side, quantity, price and state
+                InquiryMessage message;
+                memset(&message, 0, sizeof(message));
+                long quantity=0;
+                Side side=BUY;
+                InquiryState state=RECEIVED;
+                if(reader.Split(fields, 5)<5){
+                    ec=PARSE_MISSING_FIELDS;
+                }
+                else{
+                    ParseResult result=ParseSide(fields[1], side);
+                    if(result.ec==PARSE_OK) result=ParseLong(fields[2], quantity);
+                    if(result.ec==PARSE_OK) result=ParsePriceTicks(fields[3], message.price);
+                    if(result.ec==PARSE_OK) result=ParseInquiryState(fields[4], state);
+                    ec=result.ec;
+                }
+                if(ec==PARSE_OK){
+                    std::string id="INQ"+std::to_string(sent+1);
+                    SetMessageField(message.product, fields[0].data(), fields[0].size());
+                    SetMessageField(message.inquiryId, id.data(), id.size());
+                    message.quantity=quantity;
+                    message.side=side;
+                    message.state=state;
+                    ok=writer.Send(INQUIRY_MESSAGE, &message, sizeof(message));
+                }
+            }
+
+            stats.CountLine(ec);
+            if(ec!=PARSE_OK){
+                continue;
+            }
+            if(!ok){
+                std::cout<<socket<<" was closed by the receiver!"<<std::endl;
+                return 1;
+            }
+            ++sent;
+        }
+    }
+    if(!writer.Flush()){
+        std::cout<<socket<<" was closed by the receiver!"<<std::endl;
+        return 1;
+    }
+    std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-start;
+
+    std::cout<<stats<<std::endl;
+    std::cout<<sent<<" messages sent to "<<socket<<" in "<<elapsed.count()<<"s"<<std::endl;
+    return 0;
+}
@@ -0,0 +1,159 @@
+/**
+ * parsestats.hpp
+ * Defines the result codes of the field parsers and the per-file counters of skipped lines.
+ * Parsers report failures through return codes in the style of std::from_chars instead of throwing,
+ * so a bad line only costs a branch: the connector skips it and counts it by reason.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef PARSE_STATS_HPP
+#define PARSE_STATS_HPP
+
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// Reasons a field (and so its line) can fail to parse
+enum ParseErrc { PARSE_OK, PARSE_EMPTY_FIELD, PARSE_INVALID_CHARACTER, PARSE_OUT_OF_RANGE, PARSE_MISSING_FIELDS, PARSE_UNKNOWN_VALUE };
+
+const int PARSE_ERRC_COUNT = 6;
+
+// Get a readable name for a parse result code
+const char* ParseErrcName(ParseErrc ec);
+
+/**
+ * Result of parsing one field.
+ * ptr points at the first character that was not consumed, ec is PARSE_OK on success.
+ */
+struct ParseResult
+{
+    const char* ptr;
+    ParseErrc ec;
+};
+
+/**
+ * Counters of the lines read from one input file, split by the reason a line was skipped.
+ */
+class ParseStats
+{
+
+public:
+
+    // ctor for the counters of the named file
+    explicit ParseStats(const std::string &_source = "");
+
+    // Clear all counters
+    void Reset();
+
+    // Count one line, PARSE_OK if it was parsed or the reason it was skipped
+    void CountLine(ParseErrc ec);
+
+    // Add the counters of another part of the same file
+    void Merge(const ParseStats &other);
+
+    // Get the name of the file
+    const string& GetSource() const;
+
+    // Get the number of lines read
+    long GetLines() const;
+
+    // Get the number of lines parsed
+    long GetParsed() const;
+
+    // Get the number of lines skipped
+    long GetSkipped() const;
+
+    // Get the number of lines skipped for a reason
+    long GetSkipped(ParseErrc reason) const;
+
+    // print the counters, reasons that never happened are left out
+    friend ostream& operator << (ostream& os, const ParseStats& stats){
+        os<<stats.source<<": "<<stats.GetLines()<<" lines, "<<stats.GetParsed()<<" parsed, "<<stats.GetSkipped()<<" skipped";
+        for(int i=1;i<PARSE_ERRC_COUNT;++i){
+            if(stats.counts[i]){
+                os<<", "<<ParseErrcName(static_cast<ParseErrc>(i))<<": "<<stats.counts[i];
+            }
+        }
+        return os;
+    }
+
+private:
+    string source;
+    long counts[PARSE_ERRC_COUNT];
+
+};
+
+
+
+const char* ParseErrcName(ParseErrc ec)
+{
+    switch (ec) {
+        case PARSE_OK : return "ok";
+        case PARSE_EMPTY_FIELD : return "empty field";
+        case PARSE_INVALID_CHARACTER : return "invalid character";
+        case PARSE_OUT_OF_RANGE : return "out of range";
+        case PARSE_MISSING_FIELDS : return "missing fields";
+        case PARSE_UNKNOWN_VALUE : return "unknown value";
+    }
+    return "unknown";
+}
+
+
+
+//define member functions in class: ParseStats
+ParseStats::ParseStats(const std::string &_source) :
+        source(_source)
+{
+    Reset();
+}
+
+void ParseStats::Reset()
+{
+    for (int i = 0; i < PARSE_ERRC_COUNT; ++i) {
+        counts[i] = 0;
+    }
+}
+
+void ParseStats::CountLine(ParseErrc ec)
+{
+    ++counts[ec];
+}
+
+void ParseStats::Merge(const ParseStats &other)
+{
+    for (int i = 0; i < PARSE_ERRC_COUNT; ++i) {
+        counts[i] += other.counts[i];
+    }
+}
+
+const string& ParseStats::GetSource() const
+{
+    return source;
+}
+
+long ParseStats::GetLines() const
+{
+    long lines = 0;
+    for (int i = 0; i < PARSE_ERRC_COUNT; ++i) {
+        lines += counts[i];
+    }
+    return lines;
+}
+
+long ParseStats::GetParsed() const
+{
+    return counts[PARSE_OK];
+}
+
+long ParseStats::GetSkipped() const
+{
+    return GetLines() - counts[PARSE_OK];
+}
+
+long ParseStats::GetSkipped(ParseErrc reason) const
+{
+    return reason == PARSE_OK ? 0 : counts[reason];
+}
+
+#endif
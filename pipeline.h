@@ -0,0 +1,273 @@
+/**
+ * pipeline.hpp
+ * Defines a pipeline of services composed at compile time, as an alternative to chaining them with ServiceListeners.
+ *
+ * Pipeline<A, B, C> pushes each event into stage A, which hands its output straight to B and B to C.
+ * Every hop is a call on a known type, so the compiler can inline the whole path instead of making
+ * a virtual ProcessAdd call and a call into the next service at every hop.
+ * A stage updates its service through the service's Apply member (the same update OnMessage and the
+ * Add members do) and does not notify the service's listeners, so a path driven by a Pipeline should not
+ * also be wired up with listeners.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "soa.h"
+#include "tradebookingservice.h"
+#include "positionservice.h"
+#include "riskservice.h"
+#include "marketdataservice.h"
+#include "algoexecutionservice.h"
+#include "bondexecutionservice.h"
+#include "historicaldataservice.h"
+
+/**
+ * A pipeline of stages. Each stage has an Input type and a member
+ *     template<typename Next> void Process(Input &data, Next &next)
+ * which does its work and calls next.Push with its output (or not at all to stop the event).
+ */
+template<typename... Stages>
+class Pipeline;
+
+// The end of every pipeline, whatever reaches it is dropped
+template<>
+class Pipeline<>
+{
+
+public:
+
+    // Push data past the last stage
+    template<typename V>
+    void Push(V &data) {}
+
+};
+
+template<typename Head, typename... Tail>
+class Pipeline<Head, Tail...>
+{
+
+public:
+
+    // The type of event the pipeline takes
+    typedef typename Head::Input Input;
+
+    // Push an event into the first stage
+    void Push(Input &data){
+        head.Process(data, tail);
+    }
+
+    // Get the first stage
+    Head& GetHead(){
+        return head;
+    }
+
+    // Get the pipeline after the first stage
+    Pipeline<Tail...>& GetTail(){
+        return tail;
+    }
+
+private:
+    Head head;
+    Pipeline<Tail...> tail;
+
+};
+
+
+/**
+ * Stages of Path2: TradeBookingService -> PositionService -> RiskService -> HistoricalDataService
+ */
+class TradeBookingStage
+{
+
+public:
+    typedef Trade<Bond> Input;
+
+    TradeBookingStage() : service(TradeBookingService::Generate_Instance()) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){
+        next.Push(service->ApplyTrade(data));
+    }
+
+private:
+    TradeBookingService* service;
+
+};
+
+class PositionStage
+{
+
+public:
+    typedef Trade<Bond> Input;
+
+    PositionStage() : service(PositionService::Generate_Instance()) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){
+        next.Push(service->ApplyTrade(data));
+    }
+
+private:
+    PositionService* service;
+
+};
+
+class RiskStage
+{
+
+public:
+    typedef Position<Bond> Input;
+
+    RiskStage() : service(RiskService::Generate_Instance()) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){
+        next.Push(service->ApplyPosition(data));
+    }
+
+private:
+    RiskService* service;
+
+};
+
+class HistoricalPV01Stage
+{
+
+public:
+    typedef PV01<Bond> Input;
+
+    HistoricalPV01Stage() : service(BondHistoricalPV01Service::Generate_Instance()) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){
+        //store and write it
+        service->ApplyPV01(data);
+        service->PersistData(data.GetProduct().GetProductId(), data);
+        next.Push(data);
+    }
+
+private:
+    BondHistoricalPV01Service* service;
+
+};
+
+
+/**
+ * Stages of Path5: MarketDataService -> AlgoExecutionService -> ExecutionService -> HistoricalDataService
+ */
+class MarketDataStage
+{
+
+public:
+    typedef OrderBook<Bond> Input;
+
+    MarketDataStage() : service(MarketDataService::Generate_Instance()) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){
+        next.Push(service->ApplyOrderBook(data));
+    }
+
+private:
+    MarketDataService* service;
+
+};
+
+class AlgoExecutionStage
+{
+
+public:
+    typedef OrderBook<Bond> Input;
+
+    AlgoExecutionStage() : service(AlgoExecutionService::Generate_Instance()) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){
+        next.Push(service->ApplyOrderBook(data));
+    }
+
+private:
+    AlgoExecutionService* service;
+
+};
+
+class ExecutionStage
+{
+
+public:
+    typedef AlgoExecution Input;
+
+    ExecutionStage() : service(BondExecutionService::Generate_Instance()) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){
+        next.Push(service->ApplyAlgoExecution(data));
+    }
+
+private:
+    BondExecutionService* service;
+
+};
+
+class HistoricalExecutionStage
+{
+
+public:
+    typedef ExecutionOrder<Bond> Input;
+
+    HistoricalExecutionStage() : service(BondHistoricalExecutionService::Generate_Instance()) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){
+        //store and write it
+        service->ApplyExecutionOrder(data);
+        service->PersistData(data.GetProduct().GetProductId(), data);
+        next.Push(data);
+    }
+
+private:
+    BondHistoricalExecutionService* service;
+
+};
+
+
+// Path2 and Path5 composed at compile time
+typedef Pipeline<TradeBookingStage, PositionStage, RiskStage, HistoricalPV01Stage> Path2Pipeline;
+typedef Pipeline<MarketDataStage, AlgoExecutionStage, ExecutionStage, HistoricalExecutionStage> Path5Pipeline;
+
+/**
+ * A ServiceListener that pushes what it is given into a pipeline, so the existing file connectors can drive a
+ * pipeline: register it where the first service of the path would be notified.
+ */
+template<typename P>
+class PipelineListener : public ServiceListener<typename P::Input>
+{
+
+public:
+
+    // ctor for a listener feeding the given pipeline
+    explicit PipelineListener(P &_pipeline) : pipeline(_pipeline) {}
+
+    // Listener callback to process an add event to the Service
+    void ProcessAdd(typename P::Input &data){
+        pipeline.Push(data);
+    }
+
+    // Listener callback to process a remove event to the Service
+    void ProcessRemove(typename P::Input &data){
+        // no implementation
+    }
+
+    // Listener callback to process an update event to the Service
+    void ProcessUpdate(typename P::Input &data){
+        // no implementation
+    }
+
+private:
+    P& pipeline;
+
+};
+
+#endif
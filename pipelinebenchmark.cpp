@@ -0,0 +1,233 @@
+/**
+ * pipelinebenchmark.cpp
+ * Compares the cost per event of a path wired with ServiceListeners (soa.h virtual dispatch) against
+ * the same path composed at compile time with a Pipeline (pipeline.h).
+ *
+ * The first comparison is a bare 4 hop chain that only adds up a counter, so it measures the dispatch itself.
+ * The second runs Path2 (TradeBookingService -> PositionService -> RiskService) and Path5
+ * (MarketDataService -> AlgoExecutionService -> BondExecutionService) through the real services, ending in
+ * a counting sink instead of the historical data files so that disk writes do not hide the difference.
+ * The listener chains still log every hop (logger.h); build with -DLOG_MIN_LEVEL=1 to compile that out as well.
+ *
+ * Usage: pipelinebenchmark [--events N]
+ * Build it with optimisation (e.g. -O2), without it nothing is inlined and the comparison says little.
+ *
+ * @author Sijia Zhang
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "products.h"
+#include "positionservice.h"
+#include "riskservice.h"
+#include "support.h"
+#include "pipeline.h"
+
+using namespace std;
+
+// A hop of the bare chain as a ServiceListener, it counts and notifies the next hop
+class CountingListener : public ServiceListener<long>
+{
+
+public:
+
+    CountingListener(ServiceListener<long>* _next) : next(_next), total(0) {}
+
+    void ProcessAdd(long &data){
+        total+=data;
+        if(next) next->ProcessAdd(data);
+    }
+
+    void ProcessRemove(long &data) {}
+
+    void ProcessUpdate(long &data) {}
+
+    long GetTotal() const { return total; }
+
+private:
+    ServiceListener<long>* next;
+    long total;
+
+};
+
+// A hop of the bare chain as a pipeline stage
+class CountingStage
+{
+
+public:
+    typedef long Input;
+
+    CountingStage() : total(0) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){
+        total+=data;
+        next.Push(data);
+    }
+
+    long GetTotal() const { return total; }
+
+private:
+    long total;
+
+};
+
+// The end of a benchmarked path, it only counts what reaches it
+template<typename V>
+class SinkListener : public ServiceListener<V>
+{
+
+public:
+
+    SinkListener() : count(0) {}
+
+    void ProcessAdd(V &data){ ++count; }
+
+    void ProcessRemove(V &data) {}
+
+    void ProcessUpdate(V &data) {}
+
+    long GetCount() const { return count; }
+
+private:
+    long count;
+
+};
+
+template<typename V>
+class SinkStage
+{
+
+public:
+    typedef V Input;
+
+    SinkStage() : count(0) {}
+
+    template<typename Next>
+    void Process(Input &data, Next &next){ ++count; }
+
+    long GetCount() const { return count; }
+
+private:
+    long count;
+
+};
+
+// Print the time per event of a run
+void Report(const std::string &name, std::chrono::steady_clock::duration elapsed, long events, long reached)
+{
+    double ns=std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    std::cout<<name<<": "<<ns/events<<" ns/event ("<<reached<<" of "<<events<<" events reached the end)"<<std::endl;
+}
+
+int main(int argc, char* argv[]){
+    long events=1000000;
+    for(int i=1;i+1<argc;i+=2){
+        std::string option=argv[i], value=argv[i+1];
+        if(option=="--events") events=std::stol(value);
+        else{
+            std::cout<<"Unknown option: "<<option<<std::endl;
+            return 1;
+        }
+    }
+
+    //bare 4 hop chain
+    {
+        CountingListener l4(nullptr), l3(&l4), l2(&l3), l1(&l2);
+        ServiceListener<long>* head=&l1;
+        auto start=std::chrono::steady_clock::now();
+        for(long n=0;n<events;++n){
+            head->ProcessAdd(n);
+        }
+        Report("4 hops, virtual listeners", std::chrono::steady_clock::now()-start, events, l4.GetTotal()==events*(events-1)/2 ? events : 0);
+
+        Pipeline<CountingStage, CountingStage, CountingStage, CountingStage> pipeline;
+        start=std::chrono::steady_clock::now();
+        for(long n=0;n<events;++n){
+            pipeline.Push(n);
+        }
+        long total=pipeline.GetTail().GetTail().GetTail().GetHead().GetTotal();
+        Report("4 hops, pipeline", std::chrono::steady_clock::now()-start, events, total==events*(events-1)/2 ? events : 0);
+    }
+
+    //the real services need the bonds and their positions
+    bond_file();
+    load_bonds();
+    auto bond_product_service=BondProductService::Generate_Instance();
+    std::vector<const Bond*> bonds;
+    for(auto& cusip: CUSIPS_CONTAINER){
+        bonds.push_back(&bond_product_service->GetData(cusip));
+    }
+
+    //the events are built up front and reused, trade ids repeat so the booked trades stay a fixed set
+    std::vector<Trade<Bond>> trades;
+    for(long n=0;n<1000;++n){
+        trades.push_back(Trade<Bond>(*bonds[n%bonds.size()], "BENCH"+std::to_string(n), TickPrice(99*TICKS_PER_POINT+128), "TRSY"+std::to_string(n%3+1), 1000000, n%2 ? SELL : BUY));
+    }
+    std::vector<OrderBook<Bond>> books;
+    for(long n=0;n<1000;++n){
+        std::vector<Order> bid_stack, offer_stack;
+        for(int k=1;k<=5;++k){
+            bid_stack.push_back(Order(TickPrice(99*TICKS_PER_POINT+128-k-n%2), 1000000L*k, BID));
+            offer_stack.push_back(Order(TickPrice(99*TICKS_PER_POINT+128+k), 1000000L*k, OFFER));
+        }
+        books.push_back(OrderBook<Bond>(*bonds[n%bonds.size()], bid_stack, offer_stack));
+    }
+
+    //Path2 through listeners
+    {
+        SinkListener<PV01<Bond>> sink;
+        auto trade_booking_service=TradeBookingService::Generate_Instance();
+        trade_booking_service->AddListener(PositionServiceListener::Generate_Instance());
+        PositionService::Generate_Instance()->AddListener(RiskServiceListener::Generate_Instance());
+        RiskService::Generate_Instance()->AddListener(&sink);
+
+        auto start=std::chrono::steady_clock::now();
+        for(long n=0;n<events;++n){
+            trade_booking_service->OnMessage(trades[n%trades.size()]);
+        }
+        auto elapsed=std::chrono::steady_clock::now()-start;
+        Report("Path2, virtual listeners", elapsed, events, sink.GetCount());
+    }
+
+    //Path2 as a pipeline
+    {
+        Pipeline<TradeBookingStage, PositionStage, RiskStage, SinkStage<PV01<Bond>>> pipeline;
+        auto start=std::chrono::steady_clock::now();
+        for(long n=0;n<events;++n){
+            pipeline.Push(trades[n%trades.size()]);
+        }
+        auto elapsed=std::chrono::steady_clock::now()-start;
+        Report("Path2, pipeline", elapsed, events, pipeline.GetTail().GetTail().GetTail().GetHead().GetCount());
+    }
+
+    //Path5 through listeners
+    {
+        SinkListener<ExecutionOrder<Bond>> sink;
+        auto market_data_service=MarketDataService::Generate_Instance();
+        market_data_service->AddListener(AlgoExecutionServiceListener::Generate_Instance());
+        AlgoExecutionService::Generate_Instance()->AddListener(BondExecutionServiceListener::Generate_Instance());
+        BondExecutionService::Generate_Instance()->AddListener(&sink);
+
+        auto start=std::chrono::steady_clock::now();
+        for(long n=0;n<events;++n){
+            market_data_service->OnMessage(books[n%books.size()]);
+        }
+        auto elapsed=std::chrono::steady_clock::now()-start;
+        Report("Path5, virtual listeners", elapsed, events, sink.GetCount());
+    }
+
+    //Path5 as a pipeline
+    {
+        Pipeline<MarketDataStage, AlgoExecutionStage, ExecutionStage, SinkStage<ExecutionOrder<Bond>>> pipeline;
+        auto start=std::chrono::steady_clock::now();
+        for(long n=0;n<events;++n){
+            pipeline.Push(books[n%books.size()]);
+        }
+        auto elapsed=std::chrono::steady_clock::now()-start;
+        Report("Path5, pipeline", elapsed, events, pipeline.GetTail().GetTail().GetTail().GetHead().GetCount());
+    }
+
+    return 0;
+}
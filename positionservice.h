@@ -10,7 +10,9 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <mutex>
 #include "soa.h"
+#include "productindexedstore.h"
 #include "tradebookingservice.h"
 
 using namespace std;
@@ -26,7 +28,7 @@ class Position
 public:
 
     //ctor
-    Position(){};
+    Position() : productId(NO_PRODUCT) {};
 
     // ctor for a position
     Position(const T &_product);
@@ -35,17 +37,17 @@ public:
     const T& GetProduct() const;
 
     // Get the position quantity
-    long GetPosition(string &book);
+    long GetPosition(const string &book) const;
 
     // Get the aggregate position
-    long GetAggregatePosition();
+    long GetAggregatePosition() const;
 
     // AddQuantity
     // This member function is used in class: PositionServiceListener
     void AddQuantity(std::string book, long quantity);
 
 private:
-    T product;
+    ProductId productId;    // the product, interned in ProductTable<T>
     map<string,long> positions;
 
 };
@@ -64,8 +66,11 @@ private:
     //define listener
     std::vector<ServiceListener<Position<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, Position<Bond>> position_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<Position<Bond>> position_data;
+
+    //guards the structure of position_data, products may be added while shards look up theirs
+    std::mutex position_mutex;
 
     //ctor
     PositionService(){};
@@ -85,6 +90,13 @@ public:
     // Add a trade to the service
     void AddTrade(const Trade<Bond> &trade);
 
+    // Add the trade to its position without notifying listeners, return the updated position
+    Position<Bond>& ApplyTrade(const Trade<Bond> &trade);
+
+    // Add a batch of trades (or snapshots of them) to the service, the position after each trade is handed to each listener at once
+    template<typename Item>
+    void AddTradeBatch(const Item *trades, size_t count);
+
     // pure virtual member functions in class Service.
     // Get data on our service given a key
     Position<Bond>& GetData(std::string key) ;
@@ -140,6 +152,15 @@ public:
     // Listener callback to process an update event to the Service
     void ProcessUpdate(Trade<Bond> &data) ;
 
+    // Listener callback to process a batch of add events to the Service
+    void ProcessAddBatch(Trade<Bond> *data, size_t count) ;
+
+    // Listener callback to process an add event shared as a snapshot
+    void ProcessAddSnapshot(const Snapshot<Trade<Bond>> &data) ;
+
+    // Listener callback to process a batch of add events shared as snapshots
+    void ProcessAddSnapshotBatch(const Snapshot<Trade<Bond>> *data, size_t count) ;
+
     // return position service
     PositionService* GetService();
 };
@@ -148,7 +169,7 @@ public:
 //define member functions in class: Position
 template<typename T>
 Position<T>::Position(const T &_product) :
-        product(_product)
+        productId(ProductTable<T>::Generate_Instance()->Intern(_product))
 {
     //initialize positions
     //since all positions are covered by books: TRSY1, TRSY2, TRSY3, we can use loop to set up initial value
@@ -161,17 +182,18 @@ Position<T>::Position(const T &_product) :
 template<typename T>
 const T& Position<T>::GetProduct() const
 {
-    return product;
+    return ProductTable<T>::Generate_Instance()->Get(productId);
 }
 
 template<typename T>
-long Position<T>::GetPosition(string &book)
+long Position<T>::GetPosition(const string &book) const
 {
-    return positions[book];
+    auto it=positions.find(book);
+    return it==positions.end() ? 0 : it->second;
 }
 
 template<typename T>
-long Position<T>::GetAggregatePosition()
+long Position<T>::GetAggregatePosition() const
 {
     long value=0;
 
@@ -193,16 +215,14 @@ void Position<T>::AddQuantity(std::string book, long quantity)
 //define member functions in class: PositionService
 void PositionService::Addpos(Position<Bond>& ps)
 {
-    position_data.insert(std::make_pair(ps.GetProduct().GetProductId(),ps));
+    std::lock_guard<std::mutex> lock(position_mutex);
+    position_data.Insert(ps.GetProduct().GetId(),ps);
 }
 
-void PositionService::AddTrade(const Trade<Bond> &trade)
+Position<Bond>& PositionService::ApplyTrade(const Trade<Bond> &trade)
 {
-    // Add a trade to the service
-
-    //firstly, making the trade stored
     //Once a booking made, we add the amount of booking of the product in the given position
-    std::string productId=trade.GetProduct().GetProductId();
+    ProductId productId=trade.GetProduct().GetId();
 
     //define quantity of the trade
     long quantity_of_trade=0;
@@ -213,19 +233,50 @@ void PositionService::AddTrade(const Trade<Bond> &trade)
         quantity_of_trade=-trade.GetQuantity();
     }
 
-    position_data[productId].AddQuantity(trade.GetBook(),quantity_of_trade);
+    //only the lookup is locked, a product's position is only ever updated by the shard it belongs to
+    Position<Bond>* pos;
+    {
+        std::lock_guard<std::mutex> lock(position_mutex);
+        pos=&position_data[productId];
+    }
+    pos->AddQuantity(trade.GetBook(),quantity_of_trade);
+    return *pos;
+}
+
+void PositionService::AddTrade(const Trade<Bond> &trade)
+{
+    // Add a trade to the service
+
+    //firstly, making the trade stored, the position after it is snapshotted once and shared by every listener
+    Snapshot<Position<Bond>> pos(ApplyTrade(trade));
 
     //pass the trade data to listeners
-    std::cout<<"data goes from PositionService -> listener."<<std::endl;
-    Position<Bond> pos=position_data[productId];
+    LOG_TRACE("data goes from PositionService -> listener.");
     for(auto& l: listeners){
-        l->ProcessAdd(pos);
+        l->ProcessAddSnapshot(pos);
     }
 };
 
+template<typename Item>
+void PositionService::AddTradeBatch(const Item *trades, size_t count)
+{
+    //firstly, making the trades stored and snapshot the position after each of them
+    std::vector<Snapshot<Position<Bond>>> position_batch;
+    position_batch.reserve(count);
+    for(size_t i=0;i<count;++i){
+        position_batch.push_back(Snapshot<Position<Bond>>(ApplyTrade(SnapshotValue(trades[i]))));
+    }
+
+    //pass the positions to listeners
+    LOG_TRACE("data goes from PositionService -> listener. (%lu positions)", count);
+    for(auto& l: listeners){
+        l->ProcessAddSnapshotBatch(position_batch.data(), position_batch.size());
+    }
+}
+
 Position<Bond>& PositionService::GetData(std::string key) 
 {
-    return position_data.at(key);
+    return position_data.At(key);
 }
 
 void PositionService::OnMessage(Position<Bond> &data) {
@@ -249,6 +300,21 @@ void PositionServiceListener::ProcessAdd(Trade<Bond> &data)
     position_service->AddTrade(data);
 }
 
+void PositionServiceListener::ProcessAddBatch(Trade<Bond> *data, size_t count)
+{
+    position_service->AddTradeBatch(data, count);
+}
+
+void PositionServiceListener::ProcessAddSnapshot(const Snapshot<Trade<Bond>> &data)
+{
+    position_service->AddTrade(*data);
+}
+
+void PositionServiceListener::ProcessAddSnapshotBatch(const Snapshot<Trade<Bond>> *data, size_t count)
+{
+    position_service->AddTradeBatch(data, count);
+}
+
 void PositionServiceListener::ProcessRemove(Trade<Bond> &data) 
 {
     // no implementation here
@@ -0,0 +1,395 @@
+/**
+ * pricetick.hpp
+ * Defines the parser and formatter for bond prices quoted in 32nds notation.
+ * A price such as "99-16+" is 99 points, 16/32 and 4/256 (the '+' is half a 32nd).
+ * We work in integer ticks of 1/256 so that no precision is lost while parsing or formatting.
+ * TickPrice carries a price in those ticks through the services, so prices and spreads compare exactly;
+ * it is only turned into a decimal or 32nds where a price is read in or written out.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef PRICE_TICK_HPP
+#define PRICE_TICK_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <ostream>
+
+#include "boost/utility/string_view.hpp"
+#include "parsestats.h"
+
+using namespace std;
+
+// Number of 1/256 ticks in one point of price
+const int64_t TICKS_PER_POINT = 256;
+
+/**
+ * A price or spread as a whole number of 1/256 ticks.
+ */
+class TickPrice
+{
+
+public:
+
+    // ctor for a price of zero
+    TickPrice();
+
+    // ctor for a price of the given number of 1/256 ticks
+    explicit TickPrice(int64_t _ticks);
+
+    // Get the price nearest to a decimal price
+    static TickPrice FromDecimal(double price);
+
+    // Get the number of 1/256 ticks
+    int64_t GetTicks() const;
+
+    // Get the price as a decimal
+    double ToDecimal() const;
+
+    TickPrice& operator+=(TickPrice other);
+    TickPrice& operator-=(TickPrice other);
+
+    // print the price the way the decimal price used to be printed
+    friend ostream& operator << (ostream& os, const TickPrice& price){
+        return os<<price.ToDecimal();
+    }
+
+private:
+    int64_t ticks;
+
+};
+
+TickPrice operator+(TickPrice a, TickPrice b);
+TickPrice operator-(TickPrice a, TickPrice b);
+
+// Divide a price or spread, rounding down to a whole tick
+TickPrice operator/(TickPrice a, int64_t divisor);
+
+bool operator==(TickPrice a, TickPrice b);
+bool operator!=(TickPrice a, TickPrice b);
+bool operator<(TickPrice a, TickPrice b);
+bool operator<=(TickPrice a, TickPrice b);
+bool operator>(TickPrice a, TickPrice b);
+bool operator>=(TickPrice a, TickPrice b);
+
+// Parse a price in 32nds notation into 1/256 ticks, ticks is left untouched if the price is malformed
+ParseResult ParsePriceTicks(boost::string_view s, int64_t &ticks);
+
+// Parse a column of prices, writing -1 for malformed ones, return the error of the first malformed one
+ParseErrc ParsePriceColumn(const boost::string_view *prices, size_t count, int64_t *ticks);
+
+// Convert 1/256 ticks to a decimal price
+double TicksToDecimal(int64_t ticks);
+
+// Size of a buffer large enough for any formatted price or integer
+const size_t PRICE_BUFFER_SIZE = 32;
+
+// Write a price in 1/256 ticks in 32nds notation ("99-16+") to the buffer, return the number of characters
+size_t FormatPrice(int64_t ticks, char *buffer);
+size_t FormatPrice(TickPrice price, char *buffer);
+
+// Write a price in 1/256 ticks as a decimal with 6 places, the same text std::to_string gives
+size_t FormatDecimal(int64_t ticks, char *buffer);
+size_t FormatDecimal(TickPrice price, char *buffer);
+
+// Write a decimal price with 6 places, prices off the 1/256 grid fall back to snprintf
+size_t FormatDecimal(double price, char *buffer);
+
+// Write an integer to the buffer, return the number of characters
+size_t FormatLong(long value, char *buffer);
+
+
+
+/**
+ * Lookup tables for the three characters after the '-'.
+ * The two digit 32nds map to ticks (or -1 past 31) and the last character maps to 1/256ths (or -1).
+ */
+struct PriceFractionTable
+{
+    int16_t thirtySeconds[10][10];
+    int8_t eighths[256];
+
+    PriceFractionTable()
+    {
+        for (int i = 0; i < 10; ++i) {
+            for (int j = 0; j < 10; ++j) {
+                int n = i * 10 + j;
+                thirtySeconds[i][j] = static_cast<int16_t>(n < 32 ? n * 8 : -1);
+            }
+        }
+
+        for (int c = 0; c < 256; ++c) {
+            eighths[c] = -1;
+        }
+        for (int c = '0'; c <= '7'; ++c) {
+            eighths[c] = static_cast<int8_t>(c - '0');
+        }
+        eighths[static_cast<unsigned char>('+')] = 4;
+    }
+};
+
+const PriceFractionTable PRICE_FRACTION_TABLE;
+
+/**
+ * The text of every 1/256 fraction in 32nds notation: two digits of 32nds and the eighth ('+' for 4).
+ */
+#define PRICE_FRACTION_ROW(a, b) \
+    {a, b, '0'}, {a, b, '1'}, {a, b, '2'}, {a, b, '3'}, {a, b, '+'}, {a, b, '5'}, {a, b, '6'}, {a, b, '7'}
+
+constexpr char PRICE_FRACTION_TEXT[256][3] = {
+    PRICE_FRACTION_ROW('0', '0'), PRICE_FRACTION_ROW('0', '1'), PRICE_FRACTION_ROW('0', '2'), PRICE_FRACTION_ROW('0', '3'),
+    PRICE_FRACTION_ROW('0', '4'), PRICE_FRACTION_ROW('0', '5'), PRICE_FRACTION_ROW('0', '6'), PRICE_FRACTION_ROW('0', '7'),
+    PRICE_FRACTION_ROW('0', '8'), PRICE_FRACTION_ROW('0', '9'), PRICE_FRACTION_ROW('1', '0'), PRICE_FRACTION_ROW('1', '1'),
+    PRICE_FRACTION_ROW('1', '2'), PRICE_FRACTION_ROW('1', '3'), PRICE_FRACTION_ROW('1', '4'), PRICE_FRACTION_ROW('1', '5'),
+    PRICE_FRACTION_ROW('1', '6'), PRICE_FRACTION_ROW('1', '7'), PRICE_FRACTION_ROW('1', '8'), PRICE_FRACTION_ROW('1', '9'),
+    PRICE_FRACTION_ROW('2', '0'), PRICE_FRACTION_ROW('2', '1'), PRICE_FRACTION_ROW('2', '2'), PRICE_FRACTION_ROW('2', '3'),
+    PRICE_FRACTION_ROW('2', '4'), PRICE_FRACTION_ROW('2', '5'), PRICE_FRACTION_ROW('2', '6'), PRICE_FRACTION_ROW('2', '7'),
+    PRICE_FRACTION_ROW('2', '8'), PRICE_FRACTION_ROW('2', '9'), PRICE_FRACTION_ROW('3', '0'), PRICE_FRACTION_ROW('3', '1')
+};
+
+#undef PRICE_FRACTION_ROW
+
+// Millionths of a point in k/256, rounded half to even like printf's "%f"
+constexpr int32_t FractionMicros(int32_t k)
+{
+    return (k * 390625) / 100 + (((k * 390625) % 100 > 50 || ((k * 390625) % 100 == 50 && ((k * 390625) / 100) % 2 == 1)) ? 1 : 0);
+}
+
+/**
+ * The decimal value of every 1/256 fraction in millionths of a point.
+ */
+#define PRICE_MICROS_ROW(r) \
+    FractionMicros(r * 8), FractionMicros(r * 8 + 1), FractionMicros(r * 8 + 2), FractionMicros(r * 8 + 3), \
+    FractionMicros(r * 8 + 4), FractionMicros(r * 8 + 5), FractionMicros(r * 8 + 6), FractionMicros(r * 8 + 7)
+
+constexpr int32_t PRICE_FRACTION_MICROS[256] = {
+    PRICE_MICROS_ROW(0), PRICE_MICROS_ROW(1), PRICE_MICROS_ROW(2), PRICE_MICROS_ROW(3),
+    PRICE_MICROS_ROW(4), PRICE_MICROS_ROW(5), PRICE_MICROS_ROW(6), PRICE_MICROS_ROW(7),
+    PRICE_MICROS_ROW(8), PRICE_MICROS_ROW(9), PRICE_MICROS_ROW(10), PRICE_MICROS_ROW(11),
+    PRICE_MICROS_ROW(12), PRICE_MICROS_ROW(13), PRICE_MICROS_ROW(14), PRICE_MICROS_ROW(15),
+    PRICE_MICROS_ROW(16), PRICE_MICROS_ROW(17), PRICE_MICROS_ROW(18), PRICE_MICROS_ROW(19),
+    PRICE_MICROS_ROW(20), PRICE_MICROS_ROW(21), PRICE_MICROS_ROW(22), PRICE_MICROS_ROW(23),
+    PRICE_MICROS_ROW(24), PRICE_MICROS_ROW(25), PRICE_MICROS_ROW(26), PRICE_MICROS_ROW(27),
+    PRICE_MICROS_ROW(28), PRICE_MICROS_ROW(29), PRICE_MICROS_ROW(30), PRICE_MICROS_ROW(31)
+};
+
+#undef PRICE_MICROS_ROW
+
+
+
+//define member functions in class: TickPrice
+TickPrice::TickPrice() :
+        ticks(0)
+{
+}
+
+TickPrice::TickPrice(int64_t _ticks) :
+        ticks(_ticks)
+{
+}
+
+TickPrice TickPrice::FromDecimal(double price)
+{
+    return TickPrice(static_cast<int64_t>(std::llround(price * TICKS_PER_POINT)));
+}
+
+int64_t TickPrice::GetTicks() const
+{
+    return ticks;
+}
+
+double TickPrice::ToDecimal() const
+{
+    return static_cast<double>(ticks) / TICKS_PER_POINT;
+}
+
+TickPrice& TickPrice::operator+=(TickPrice other)
+{
+    ticks += other.ticks;
+    return *this;
+}
+
+TickPrice& TickPrice::operator-=(TickPrice other)
+{
+    ticks -= other.ticks;
+    return *this;
+}
+
+TickPrice operator+(TickPrice a, TickPrice b)
+{
+    return a += b;
+}
+
+TickPrice operator-(TickPrice a, TickPrice b)
+{
+    return a -= b;
+}
+
+TickPrice operator/(TickPrice a, int64_t divisor)
+{
+    //round towards minus infinity, so a bid taken half a spread below mid never rounds up
+    int64_t q = a.GetTicks() / divisor;
+    if ((a.GetTicks() % divisor != 0) && ((a.GetTicks() < 0) != (divisor < 0))) --q;
+    return TickPrice(q);
+}
+
+bool operator==(TickPrice a, TickPrice b)
+{
+    return a.GetTicks() == b.GetTicks();
+}
+
+bool operator!=(TickPrice a, TickPrice b)
+{
+    return a.GetTicks() != b.GetTicks();
+}
+
+bool operator<(TickPrice a, TickPrice b)
+{
+    return a.GetTicks() < b.GetTicks();
+}
+
+bool operator<=(TickPrice a, TickPrice b)
+{
+    return a.GetTicks() <= b.GetTicks();
+}
+
+bool operator>(TickPrice a, TickPrice b)
+{
+    return a.GetTicks() > b.GetTicks();
+}
+
+bool operator>=(TickPrice a, TickPrice b)
+{
+    return a.GetTicks() >= b.GetTicks();
+}
+
+
+
+ParseResult ParsePriceTicks(boost::string_view s, int64_t &ticks)
+{
+    //the whole part needs at least one digit, then the '-' and exactly three characters
+    const char* first = s.data();
+    size_t n = s.size();
+    if (n == 0) return ParseResult{first, PARSE_EMPTY_FIELD};
+    if (n < 5 || s[n - 4] != '-') return ParseResult{first + n, PARSE_INVALID_CHARACTER};
+
+    //more whole digits than this cannot be held in ticks
+    if (n - 4 > 15) return ParseResult{first, PARSE_OUT_OF_RANGE};
+
+    int64_t points = 0;
+    for (size_t i = 0; i < n - 4; ++i) {
+        unsigned d = static_cast<unsigned>(s[i] - '0');
+        if (d > 9) return ParseResult{first + i, PARSE_INVALID_CHARACTER};
+        points = points * 10 + d;
+    }
+
+    unsigned d1 = static_cast<unsigned>(s[n - 3] - '0');
+    unsigned d2 = static_cast<unsigned>(s[n - 2] - '0');
+    if (d1 > 9) return ParseResult{first + n - 3, PARSE_INVALID_CHARACTER};
+    if (d2 > 9) return ParseResult{first + n - 2, PARSE_INVALID_CHARACTER};
+
+    int thirtySeconds = PRICE_FRACTION_TABLE.thirtySeconds[d1][d2];
+    int eighths = PRICE_FRACTION_TABLE.eighths[static_cast<unsigned char>(s[n - 1])];
+    if (thirtySeconds < 0) return ParseResult{first + n - 3, PARSE_OUT_OF_RANGE};
+    if (eighths < 0) return ParseResult{first + n - 1, PARSE_INVALID_CHARACTER};
+
+    ticks = points * TICKS_PER_POINT + thirtySeconds + eighths;
+    return ParseResult{first + n, PARSE_OK};
+}
+
+ParseErrc ParsePriceColumn(const boost::string_view *prices, size_t count, int64_t *ticks)
+{
+    ParseErrc first = PARSE_OK;
+    for (size_t i = 0; i < count; ++i) {
+        ParseResult r = ParsePriceTicks(prices[i], ticks[i]);
+        if (r.ec != PARSE_OK) {
+            ticks[i] = -1;
+            if (first == PARSE_OK) first = r.ec;
+        }
+    }
+    return first;
+}
+
+double TicksToDecimal(int64_t ticks)
+{
+    return static_cast<double>(ticks) / TICKS_PER_POINT;
+}
+
+size_t FormatLong(long value, char *buffer)
+{
+    //write the digits backwards into a scratch area, then move them to the front
+    char digits[24];
+    size_t n = 0;
+    bool negative = value < 0;
+    unsigned long v = negative ? 0UL - static_cast<unsigned long>(value) : static_cast<unsigned long>(value);
+
+    do {
+        digits[sizeof(digits) - 1 - n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (negative) digits[sizeof(digits) - 1 - n++] = '-';
+
+    memcpy(buffer, digits + sizeof(digits) - n, n);
+    return n;
+}
+
+size_t FormatPrice(int64_t ticks, char *buffer)
+{
+    size_t n = 0;
+    if (ticks < 0) {
+        buffer[n++] = '-';
+        ticks = -ticks;
+    }
+
+    n += FormatLong(static_cast<long>(ticks / TICKS_PER_POINT), buffer + n);
+    buffer[n++] = '-';
+    memcpy(buffer + n, PRICE_FRACTION_TEXT[ticks % TICKS_PER_POINT], 3);
+    return n + 3;
+}
+
+size_t FormatPrice(TickPrice price, char *buffer)
+{
+    return FormatPrice(price.GetTicks(), buffer);
+}
+
+size_t FormatDecimal(int64_t ticks, char *buffer)
+{
+    size_t n = 0;
+    if (ticks < 0) {
+        buffer[n++] = '-';
+        ticks = -ticks;
+    }
+
+    n += FormatLong(static_cast<long>(ticks / TICKS_PER_POINT), buffer + n);
+    buffer[n++] = '.';
+
+    int32_t micros = PRICE_FRACTION_MICROS[ticks % TICKS_PER_POINT];
+    for (int i = 5; i >= 0; --i) {
+        buffer[n + i] = static_cast<char>('0' + micros % 10);
+        micros /= 10;
+    }
+    return n + 6;
+}
+
+size_t FormatDecimal(TickPrice price, char *buffer)
+{
+    return FormatDecimal(price.GetTicks(), buffer);
+}
+
+size_t FormatDecimal(double price, char *buffer)
+{
+    double ticks = price * TICKS_PER_POINT;
+    if (ticks == std::floor(ticks) && std::fabs(ticks) < 1e15) {
+        return FormatDecimal(static_cast<int64_t>(ticks), buffer);
+    }
+
+    //snprintf returns the length the whole text would have, but only the buffer holds what was written
+    int n = snprintf(buffer, PRICE_BUFFER_SIZE, "%f", price);
+    return n < 0 ? 0 : std::min<size_t>(n, PRICE_BUFFER_SIZE - 1);
+}
+
+#endif
@@ -12,7 +12,17 @@
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <vector>
+#include <future>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
 #include "soa.h"
+#include "productindexedstore.h"
+#include "multicastring.h"
+#include "pricetick.h"
+#include "binaryformat.h"
 #include "products.h"
 
 /**
@@ -26,16 +36,16 @@ class Price
 public:
 
     // ctor for a price
-    Price(const T &_product, double _mid, double _bidOfferSpread);
+    Price(const T &_product, TickPrice _mid, TickPrice _bidOfferSpread);
 
     // Get the product
     const T& GetProduct() const;
 
     // Get the mid price
-    double GetMid() const;
+    TickPrice GetMid() const;
 
     // Get the bid/offer spread around the mid
-    double GetBidOfferSpread() const;
+    TickPrice GetBidOfferSpread() const;
 
     // we add an operator << as overloading
     friend ostream& operator << (ostream& os, const Price<T>& pri){
@@ -45,9 +55,9 @@ public:
         return os;
     }
 private:
-    const T& product;
-    double mid;
-    double bidOfferSpread;
+    ProductId productId;    // the product, interned in ProductTable<T>
+    TickPrice mid;
+    TickPrice bidOfferSpread;
 
 };
 
@@ -65,11 +75,29 @@ private:
     //define listener
     std::vector<ServiceListener<Price<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, Price<Bond>> price_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<Price<Bond>> price_data;
+
+    //a price as it sits in the multicast ring, Price itself holds a reference and cannot be assigned
+    struct PriceRecord
+    {
+        const Bond* product;
+        TickPrice mid;
+        TickPrice bidOfferSpread;
+    };
+
+    //while multicasting, OnMessage publishes into the ring and every listener reads it on its own thread
+    std::unique_ptr<MulticastRing<PriceRecord>> ring;
+
+    //how many listeners, from the first, read the ring; the ones past them are called inline as before
+    size_t multicast_listeners;
+    std::vector<std::thread> consumers;
+
+    // Body of the thread passing the prices of the ring to one listener
+    void RunConsumer(int consumer, ServiceListener<Price<Bond>>* listener);
 
     //ctor
-    PricingService(){};
+    PricingService() : multicast_listeners(0) {};
 
 public:
 
@@ -93,6 +121,16 @@ public:
 
     // Get all listeners on the Service.
     const std::vector< ServiceListener<Price<Bond>>* >& GetListeners() const ;
+
+    // StartMulticast
+    // From now on every listener added so far gets the prices on its own thread through a multicast ring,
+    // so Path3 and Path4 run side by side and a slow listener does not hold back the others
+    // Listeners past MULTICAST_RING_MAX_CONSUMERS, or added after it, are still called inline by OnMessage
+    void StartMulticast(size_t capacity = MULTICAST_RING_DEFAULT_CAPACITY);
+
+    // StopMulticast
+    // Wait until every listener has had every price, then go back to calling the listeners inline
+    void StopMulticast();
 };
 
 
@@ -110,6 +148,9 @@ private:
     PricingService* price_service;
     BondProductService* bond_product_service;
 
+    //lines read and skipped in the last file subscribed
+    ParseStats stats;
+
     //ctor
     PricingServiceConnector(){
         price_service=PricingService::Generate_Instance();
@@ -132,6 +173,18 @@ public:
     // It is used for reading data from file via OnMessage Method
     void Subscribe();
 
+    // SubscribeBinary
+    // It is used for reading data from a binary columnar file (see binaryformat.h) via OnMessage Method
+    void SubscribeBinary(const std::string &path = "../input/prices.bin");
+
+    // SubscribeParallel
+    // It is used for reading data from file with several threads parsing chunks of it,
+    // the prices are still passed to OnMessage in file order so each product keeps its order
+    void SubscribeParallel(size_t threads = std::thread::hardware_concurrency());
+
+    // Get the counts of lines read and skipped in the last file subscribed
+    const ParseStats& GetParseStats() const;
+
     // GetService
     PricingService* GetService();
 
@@ -140,8 +193,8 @@ public:
 
 //define member functions in class: Price
 template<typename T>
-Price<T>::Price(const T &_product, double _mid, double _bidOfferSpread) :
-        product(_product)
+Price<T>::Price(const T &_product, TickPrice _mid, TickPrice _bidOfferSpread) :
+        productId(ProductTable<T>::Generate_Instance()->Intern(_product))
 {
     mid = _mid;
     bidOfferSpread = _bidOfferSpread;
@@ -150,17 +203,17 @@ Price<T>::Price(const T &_product, double _mid, double _bidOfferSpread) :
 template<typename T>
 const T& Price<T>::GetProduct() const
 {
-    return product;
+    return ProductTable<T>::Generate_Instance()->Get(productId);
 }
 
 template<typename T>
-double Price<T>::GetMid() const
+TickPrice Price<T>::GetMid() const
 {
     return mid;
 }
 
 template<typename T>
-double Price<T>::GetBidOfferSpread() const
+TickPrice Price<T>::GetBidOfferSpread() const
 {
     return bidOfferSpread;
 }
@@ -171,19 +224,22 @@ double Price<T>::GetBidOfferSpread() const
 Price<Bond>& PricingService::GetData(std::string key) 
 {
     //get data given a key
-    return price_data.at(key);
+    return price_data.At(key);
 }
 
 void PricingService::OnMessage(Price<Bond> &data) 
 {
     //firstly, store the newly or updated data
-    auto key=data.GetProduct().GetProductId(); //get key
-    price_data.insert(std::make_pair(key,data));
+    price_data.Insert(data.GetProduct().GetId(),data);
 
     //then, pass the updated data to listener
-    std::cout<<"data goes from PricingService -> listener."<<std::endl;
-    for(auto& l:listeners){
-        l->ProcessAdd(data);
+    LOG_TRACE("data goes from PricingService -> listener.");
+    if(ring){
+        PriceRecord record={&data.GetProduct(), data.GetMid(), data.GetBidOfferSpread()};
+        ring->Publish(record);
+    }
+    for(size_t i=multicast_listeners;i<listeners.size();++i){
+        listeners[i]->ProcessAdd(data);
     }
 }
 
@@ -201,6 +257,81 @@ const vector<ServiceListener<Price<Bond>>* >& PricingService::GetListeners() con
 
 
 
+void PricingService::StartMulticast(size_t capacity)
+{
+    if(ring){
+        return;
+    }
+
+    //one consumer per listener, all added before the first price is published
+    ring.reset(new MulticastRing<PriceRecord>(capacity));
+    std::vector<int> ids;
+    for(size_t i=0;i<listeners.size();++i){
+        ids.push_back(ring->AddConsumer());
+    }
+    for(size_t i=0;i<listeners.size();++i){
+        //consumers run out after the first MULTICAST_RING_MAX_CONSUMERS, the rest keep getting every price inline
+        if(ids[i]<0){
+            std::cout<<"PricingService: too many listeners to multicast, listener "<<i<<" is called inline instead"<<std::endl;
+            break;
+        }
+        consumers.push_back(std::thread(&PricingService::RunConsumer, this, ids[i], listeners[i]));
+        multicast_listeners=i+1;
+    }
+}
+
+void PricingService::StopMulticast()
+{
+    if(!ring){
+        return;
+    }
+
+    ring->Close();
+    for(auto& t:consumers){
+        t.join();
+    }
+    consumers.clear();
+    ring.reset();
+    multicast_listeners=0;
+}
+
+void PricingService::RunConsumer(int consumer, ServiceListener<Price<Bond>>* listener)
+{
+    std::vector<Price<Bond>> batch;
+    batch.reserve(DEFAULT_BATCH_SIZE);
+    uint64_t next=0;
+    int idle=0;
+
+    while(true){
+        uint64_t available=ring->GetPublished();
+        if(next==available){
+            //the ring is closed after the last price, so once it is closed whatever is published is all there is
+            if(ring->IsClosed() && next==ring->GetPublished()){
+                break;
+            }
+            if(++idle<1000){
+                std::this_thread::yield();
+            }
+            else{
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            continue;
+        }
+        idle=0;
+
+        //take everything published so far, up to a batch, and release the slots before the listener runs
+        uint64_t end=std::min<uint64_t>(available, next+DEFAULT_BATCH_SIZE);
+        batch.clear();
+        for(;next<end;++next){
+            const PriceRecord& r=ring->Get(next);
+            batch.push_back(Price<Bond>(*r.product, r.mid, r.bidOfferSpread));
+        }
+        ring->Release(consumer, next);
+
+        listener->ProcessAddBatch(batch.data(), batch.size());
+    }
+}
+
 //define member functions in class: PricingServiceConnector
 void PricingServiceConnector::Publish(Price<Bond> &data) 
 {
@@ -209,70 +340,193 @@ void PricingServiceConnector::Publish(Price<Bond> &data)
 
 void PricingServiceConnector::Subscribe()
 {
-    //define some strings we will use later
-    std::string key, mid, bid_offer;
+    //map the file and do subscribing
+    stats=ParseStats("input/prices.txt");
+    MappedFile file("../input/prices.txt");
+    if(!file.IsOpen()){
+        std::cout<<"input/prices.txt cannot be opened!"<<std::endl;
+        return;
+    }
 
-    //lambda function working to split one line and return vector of parts
-    auto splitoneline = [](std::string line){
-        stringstream ss(line);
-        std::string part; //define each part in the line
-        std::vector<std::string> container; //define container to contain each part and return it
+    CsvLineReader reader(file.Begin(), file.End());
+    reader.NextLine(); //skip the header
 
-        while(getline(ss,part,',')){
-            container.push_back(part); //using comma as our separate signal
+    //each line holds a CUSIP, the mid price and the bid/offer spread
+    boost::string_view container[3];
+
+    while(reader.NextLine()){
+        if(reader.GetLine().empty()){
+            continue;
         }
 
-        return container;
-    };
+        //parse the line, bad lines are skipped and counted
+        int64_t mid=0, bid_offer=0;
+        ParseErrc ec=PARSE_OK;
+        if(reader.Split(container, 3)<3){
+            ec=PARSE_MISSING_FIELDS;
+        }
+        else if(container[0].empty()){
+            ec=PARSE_EMPTY_FIELD;
+        }
+        else{
+            ParseResult r=ParsePriceTicks(container[1], mid);
+            if(r.ec==PARSE_OK) r=ParsePriceTicks(container[2], bid_offer);
+            ec=r.ec;
+        }
+        stats.CountLine(ec);
+        if(ec!=PARSE_OK){
+            continue;
+        }
+
+        //define price
+        //find the bond in order to define trade
+        const Bond& bond=bond_product_service->GetData(std::string(container[0].data(), container[0].size()));
+        Price<Bond> price(bond, TickPrice(mid), TickPrice(bid_offer));
+
+        //using OnMessage to pass the data to PricingService
+        price_service->OnMessage(price);
+    }
 
-    //lambda function working to transposing price of the bond
-    auto PriceTranspose = [](std::string s){
-        size_t pos=s.find_first_of('-'); //position of the '-'
+    std::cout<<stats<<std::endl;
+    std::cout<<"input/price.txt -> PricingService DONE!"<<std::endl;
+}
 
-        //we use std::stoi to transpose string to double
-        //firstly, calculate the value of the first part before pos '-'
-        double value=std::stoi(s.substr(0,pos));
+void PricingServiceConnector::SubscribeBinary(const std::string &path)
+{
+    //map the file and check it holds prices
+    BinaryColumnFile file(path);
+    if(!file.IsValid() || file.GetRecordType()!=PRICE_RECORDS){
+        std::cout<<path<<" is not a binary price file!"<<std::endl;
+        return;
+    }
+
+    //resolve every product of the file to its bond once
+    std::vector<const Bond*> bonds;
+    for(size_t i=0;i<file.GetProductCount();++i){
+        bonds.push_back(&bond_product_service->GetData(file.GetProductId(i)));
+    }
 
-        //then, calculate the first value after '-', 2 char in the string
-        int temp1=std::stoi(s.substr(pos+1,2));
+    const uint32_t* product=file.GetProductColumn();
+    const int64_t* mid=file.GetColumn(PRICE_MID);
+    const int64_t* spread=file.GetColumn(PRICE_SPREAD);
 
-        //at the same time, calculate the last value in s
-        auto last=s[s.size()-1];
-        if(last=='+'){
-            last='4';
+    stats=ParseStats(path);
+    for(size_t row=0;row<file.GetRowCount();++row){
+        //a row pointing past the product table is skipped and counted, as a bad csv line is
+        if(product[row]>=bonds.size()){
+            stats.CountLine(PARSE_OUT_OF_RANGE);
+            continue;
         }
-        int temp2=last-'0';
+        stats.CountLine(PARSE_OK);
 
-        //finally, add them up and get the final value
-        double final_value=value+(temp1/32.+temp2/256.);
-        return final_value;
-    };
+        //define price and pass it to PricingService
+        Price<Bond> price(*bonds[product[row]], TickPrice(mid[row]), TickPrice(spread[row]));
+        price_service->OnMessage(price);
+    }
 
-    //read the file and do subscribing
-    ifstream iss("../input/prices.txt");
-    std::string line;
-    getline(iss,line);
+    std::cout<<stats<<std::endl;
+    std::cout<<path<<" -> PricingService DONE!"<<std::endl;
+}
 
-    //if the file is not empty
-    while(getline(iss, line)){
-        //create a vector to contain the parts in each line
-        std::vector<std::string> container=splitoneline(line);
+void PricingServiceConnector::SubscribeParallel(size_t threads)
+{
+    //a price parsed out of the file, the product still points into the mapping
+    struct ParsedPrice
+    {
+        boost::string_view product;
+        int64_t mid;
+        int64_t spread;
+    };
 
-        //using the string defined above as the name of different parts
-        key=container[0];
-        mid=container[1];
-        bid_offer=container[2];
+    //the prices of one chunk and the counts of its lines
+    struct ParsedChunk
+    {
+        std::vector<ParsedPrice> prices;
+        ParseStats stats;
+    };
 
-        //define price
-        //find the bond in order to define trade
-        auto bond=bond_product_service->GetData(key);
-        Price<Bond> price(bond, PriceTranspose(mid), PriceTranspose(bid_offer));
+    //map the file and do subscribing
+    stats=ParseStats("input/prices.txt");
+    MappedFile file("../input/prices.txt");
+    if(!file.IsOpen()){
+        std::cout<<"input/prices.txt cannot be opened!"<<std::endl;
+        return;
+    }
 
-        //using OnMessage to pass the data to PricingService
-        price_service->OnMessage(price);
+    //skip the header, then cut the rest of the file into one chunk per thread at line boundaries
+    const char* body=file.Size() ? static_cast<const char*>(memchr(file.Begin(), '\n', file.Size())) : nullptr;
+    body=body ? body+1 : file.End();
+
+    std::vector<std::pair<const char*, const char*>> chunks=SplitAtLines(body, file.End(), threads==0 ? 1 : threads);
+
+    //parse every chunk concurrently
+    std::vector<std::future<ParsedChunk>> parsed;
+    for(auto& chunk:chunks){
+        parsed.push_back(std::async(std::launch::async, [chunk](){
+            ParsedChunk container;
+            CsvLineReader reader(chunk.first, chunk.second);
+            boost::string_view fields[3];
+
+            while(reader.NextLine()){
+                if(reader.GetLine().empty()){
+                    continue;
+                }
+
+                //bad lines are skipped and counted
+                ParsedPrice p={boost::string_view(), 0, 0};
+                ParseErrc ec=PARSE_OK;
+                if(reader.Split(fields, 3)<3){
+                    ec=PARSE_MISSING_FIELDS;
+                }
+                else if(fields[0].empty()){
+                    ec=PARSE_EMPTY_FIELD;
+                }
+                else{
+                    p.product=fields[0];
+                    ParseResult r=ParsePriceTicks(fields[1], p.mid);
+                    if(r.ec==PARSE_OK) r=ParsePriceTicks(fields[2], p.spread);
+                    ec=r.ec;
+                }
+                container.stats.CountLine(ec);
+                if(ec==PARSE_OK){
+                    container.prices.push_back(p);
+                }
+            }
+            return container;
+        }));
     }
 
-    std::cout<<"input/price.txt -> PricingService DONE!"<<std::endl;
+    //dispatch the chunks in file order as soon as each one is parsed
+    std::map<boost::string_view, const Bond*> bond_cache;
+    boost::string_view last_key;
+    const Bond* bond=nullptr;
+
+    for(auto& f:parsed){
+        ParsedChunk container=f.get();
+        stats.Merge(container.stats);
+        for(auto& p:container.prices){
+            //find the bond in order to define price, lines of the same CUSIP come together
+            if(bond==nullptr || p.product!=last_key){
+                auto it=bond_cache.find(p.product);
+                if(it==bond_cache.end()){
+                    it=bond_cache.insert(std::make_pair(p.product, &bond_product_service->GetData(std::string(p.product.data(), p.product.size())))).first;
+                }
+                last_key=p.product;
+                bond=it->second;
+            }
+
+            Price<Bond> price(*bond, TickPrice(p.mid), TickPrice(p.spread));
+            price_service->OnMessage(price);
+        }
+    }
+
+    std::cout<<stats<<std::endl;
+    std::cout<<"input/prices.txt -> PricingService DONE!"<<std::endl;
+}
+
+const ParseStats& PricingServiceConnector::GetParseStats() const
+{
+    return stats;
 }
 
 PricingService* PricingServiceConnector::GetService()
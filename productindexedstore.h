@@ -0,0 +1,205 @@
+/**
+ * productindexedstore.hpp
+ * Defines the container services keep their per-product state in, keyed by the dense ProductId of producttable.h.
+ *
+ * A std::map<std::string, V> compares CUSIP strings on every lookup and chases a pointer per node on every
+ * walk. ProductIndexedStore<V> looks a product up by its id in a flat array of slots, so a lookup costs the
+ * same however many products are loaded, and keeps the values themselves packed in chunks of
+ * PRODUCT_STORE_CHUNK_SIZE, in the order they were added. A chunk never grows past its reserved size, so
+ * a value never moves once added: like a map, references to it stay valid while other products are added.
+ *
+ * The store does no locking of its own; a service that adds products from several threads guards it as it
+ * guarded its map.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef PRODUCT_INDEXED_STORE_HPP
+#define PRODUCT_INDEXED_STORE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+#include <cstdint>
+#include "products.h"
+#include "producttable.h"
+
+using namespace std;
+
+// Number of values stored together in one chunk
+const size_t PRODUCT_STORE_CHUNK_SIZE = 64;
+
+/**
+ * Values of type V, at most one per product of type T, looked up by ProductId.
+ */
+template<typename V, typename T = Bond>
+class ProductIndexedStore
+{
+
+public:
+
+    // ctor for an empty store
+    ProductIndexedStore();
+
+    // Get the number of products with a value
+    size_t GetSize() const;
+
+    // Whether the product has a value
+    bool Contains(ProductId id) const;
+
+    // Get the value of a product, nullptr if it has none
+    V* Find(ProductId id);
+    const V* Find(ProductId id) const;
+
+    // Get the value of a product, throw std::out_of_range if it has none
+    V& At(ProductId id);
+    const V& At(ProductId id) const;
+
+    // Get the value of a product by its product identifier, throw std::out_of_range if it has none
+    V& At(const std::string &productId);
+
+    // Get the value of a product, adding a default-constructed one if it has none
+    V& operator[](ProductId id);
+
+    // Add a value for a product that has none, return the value of the product and whether it was added
+    std::pair<V*, bool> Insert(ProductId id, const V &value);
+
+    // Add or replace the value of a product
+    V& Set(ProductId id, const V &value);
+
+    // Call f on every value, in the order the products were added
+    template<typename F>
+    void ForEach(F f) const;
+
+private:
+
+    // a slot no value is in
+    static const uint32_t NO_SLOT = UINT32_MAX;
+
+    // Add the value of a product that has none
+    V& Append(ProductId id, const V &value);
+
+    std::vector<uint32_t> slots;                        // the slot of each product id, NO_SLOT if it has no value
+    std::vector<std::unique_ptr<std::vector<V>>> chunks; // the values, PRODUCT_STORE_CHUNK_SIZE to a chunk
+    size_t size;
+
+};
+
+
+
+//define member functions in class: ProductIndexedStore
+template<typename V, typename T>
+const uint32_t ProductIndexedStore<V, T>::NO_SLOT;
+
+template<typename V, typename T>
+ProductIndexedStore<V, T>::ProductIndexedStore() :
+        size(0)
+{
+}
+
+template<typename V, typename T>
+size_t ProductIndexedStore<V, T>::GetSize() const
+{
+    return size;
+}
+
+template<typename V, typename T>
+bool ProductIndexedStore<V, T>::Contains(ProductId id) const
+{
+    return id < slots.size() && slots[id] != NO_SLOT;
+}
+
+template<typename V, typename T>
+V* ProductIndexedStore<V, T>::Find(ProductId id)
+{
+    if (!Contains(id)) return nullptr;
+    uint32_t slot = slots[id];
+    return &(*chunks[slot / PRODUCT_STORE_CHUNK_SIZE])[slot % PRODUCT_STORE_CHUNK_SIZE];
+}
+
+template<typename V, typename T>
+const V* ProductIndexedStore<V, T>::Find(ProductId id) const
+{
+    if (!Contains(id)) return nullptr;
+    uint32_t slot = slots[id];
+    return &(*chunks[slot / PRODUCT_STORE_CHUNK_SIZE])[slot % PRODUCT_STORE_CHUNK_SIZE];
+}
+
+template<typename V, typename T>
+V& ProductIndexedStore<V, T>::At(ProductId id)
+{
+    V* value = Find(id);
+    if (!value) throw std::out_of_range("ProductIndexedStore::At: no value for product " + std::to_string(id));
+    return *value;
+}
+
+template<typename V, typename T>
+const V& ProductIndexedStore<V, T>::At(ProductId id) const
+{
+    const V* value = Find(id);
+    if (!value) throw std::out_of_range("ProductIndexedStore::At: no value for product " + std::to_string(id));
+    return *value;
+}
+
+template<typename V, typename T>
+V& ProductIndexedStore<V, T>::At(const std::string &productId)
+{
+    ProductId id = NO_PRODUCT;
+    if (!ProductTable<T>::Generate_Instance()->Find(productId, id) || !Contains(id)) {
+        throw std::out_of_range("ProductIndexedStore::At: no value for product " + productId);
+    }
+    return At(id);
+}
+
+template<typename V, typename T>
+V& ProductIndexedStore<V, T>::operator[](ProductId id)
+{
+    V* value = Find(id);
+    return value ? *value : Append(id, V());
+}
+
+template<typename V, typename T>
+std::pair<V*, bool> ProductIndexedStore<V, T>::Insert(ProductId id, const V &value)
+{
+    V* existing = Find(id);
+    if (existing) return std::make_pair(existing, false);
+    return std::make_pair(&Append(id, value), true);
+}
+
+template<typename V, typename T>
+V& ProductIndexedStore<V, T>::Set(ProductId id, const V &value)
+{
+    V* existing = Find(id);
+    if (!existing) return Append(id, value);
+    *existing = value;
+    return *existing;
+}
+
+template<typename V, typename T>
+template<typename F>
+void ProductIndexedStore<V, T>::ForEach(F f) const
+{
+    for (auto& chunk : chunks) {
+        for (auto& value : *chunk) {
+            f(value);
+        }
+    }
+}
+
+template<typename V, typename T>
+V& ProductIndexedStore<V, T>::Append(ProductId id, const V &value)
+{
+    if (id >= slots.size()) slots.resize(static_cast<size_t>(id) + 1, NO_SLOT);
+
+    //a full chunk is never grown, its values would move
+    if (size % PRODUCT_STORE_CHUNK_SIZE == 0) {
+        chunks.push_back(std::unique_ptr<std::vector<V>>(new std::vector<V>()));
+        chunks.back()->reserve(PRODUCT_STORE_CHUNK_SIZE);
+    }
+    chunks.back()->push_back(value);
+    slots[id] = static_cast<uint32_t>(size++);
+    return chunks.back()->back();
+}
+
+#endif
@@ -10,7 +10,11 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
 
+#include "producttable.h"
 #include "boost/date_time/gregorian/gregorian.hpp"
 
 using namespace std;
@@ -35,9 +39,17 @@ public:
     // Ge the product type
     ProductType GetProductType() const;
 
+    // Get the id the product is interned under in its ProductTable, NO_PRODUCT if it is not
+    ProductId GetId() const;
+
 private:
     string productId;
     ProductType productType;
+    ProductId id;
+
+    // only the table sets the id of the copy it keeps
+    template<typename T>
+    friend class ProductTable;
 
 };
 
@@ -72,7 +84,6 @@ public:
     friend ostream& operator<<(ostream &output, const Bond &bond);
 
 private:
-    string productId;
     BondIdType bondIdType;
     string ticker;
     float coupon;
@@ -80,6 +91,48 @@ private:
 
 };
 
+// Year maturities are bucketed from: FrontEnd is up to 3 years after it, Belly up to 10, LongEnd beyond
+const int MATURITY_BUCKET_BASE_YEAR = 2017;
+
+// Maturity buckets risk is aggregated by
+enum MaturityBucket { FRONT_END, BELLY, LONG_END };
+const int MATURITY_BUCKET_COUNT = 3;
+
+// Get the bucket a maturity date falls in
+MaturityBucket GetMaturityBucket(const date &maturityDate);
+
+/**
+ * A non-owning view of count contiguous values of type T, valid until what it views changes.
+ */
+template<typename T>
+class Span
+{
+
+public:
+
+    // ctor for an empty view
+    Span() : first(nullptr), count(0) {}
+
+    // ctor for a view of the count values from _first
+    Span(const T *_first, size_t _count) : first(_first), count(_count) {}
+
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+
+    // Get the number of values
+    size_t size() const { return count; }
+
+    // Whether there is no value
+    bool empty() const { return count == 0; }
+
+    const T& operator[](size_t i) const { return first[i]; }
+
+private:
+    const T* first;
+    size_t count;
+
+};
+
 /**
  * Base class for bondService
  * Pure Virtual member function GetData
@@ -90,7 +143,7 @@ class BondService{
 
 public:
 
-    virtual V& GetData(K key) = 0;
+    virtual const V& GetData(K key) = 0;
 
 };
 
@@ -98,18 +151,30 @@ public:
 /**
  * BondProductService is working as adding data, getting data, etc.
  * Using Bond as type instead of V and K
+ * The bonds themselves are kept once in ProductTable<Bond>, the service hands out references into it.
+ * Indexes by ticker, by maturity and by coupon are kept up to date as bonds are added, so the queries on them
+ * cost the size of their result and return a Span of pointers into the table, valid until the next AddBond.
  */
 class BondProductService: public BondService<std::string, Bond>{
 
 private:
 
-    //define a map to cache of bond products
-    std::map<std::string, Bond> bond_map;
+    //define a pointer of the table every bond is interned in
+    ProductTable<Bond>* bond_table;
+
+    //define the secondary indexes, each holding every added bond once
+    std::unordered_map<std::string, std::vector<const Bond*>> ticker_index;
+    std::vector<const Bond*> maturity_index;    // sorted by maturity date
+    std::vector<const Bond*> coupon_index;      // sorted by coupon
+    std::vector<bool> indexed;                  // whether each id is in the indexes
+
+    // Add an interned bond to the indexes
+    void IndexBond(const Bond& bond);
 
 
     // ctor
     BondProductService(){
-        bond_map=map<std::string, Bond>();
+        bond_table=ProductTable<Bond>::Generate_Instance();
     }
 
 public:
@@ -120,14 +185,26 @@ public:
         return &ins;
     }
 
-    // Add a bond to the service
-    void AddBond(Bond& bond);
+    // Add a bond to the service, return the id it is interned under
+    ProductId AddBond(const Bond& bond);
+
+    // GetData, the default bond if key was never added
+    const Bond& GetData(std::string key);
 
-    // GetData
-    Bond& GetData(std::string key);
+    // Get the interned bond of an id
+    const Bond& GetData(ProductId id) const;
 
     // GetBonds gets all bonds with specific ticker
-    std::vector<Bond> GetBonds(const std::string& ticker) const;
+    Span<const Bond*> GetBonds(const std::string& ticker) const;
+
+    // Get all bonds in a maturity bucket, by maturity
+    Span<const Bond*> GetBonds(MaturityBucket bucket) const;
+
+    // Get all bonds maturing in [from, to), by maturity
+    Span<const Bond*> GetBondsMaturingBetween(const date& from, const date& to) const;
+
+    // Get all bonds with a coupon in [low, high], by coupon
+    Span<const Bond*> GetBondsByCoupon(float low, float high) const;
 };
 
 
@@ -137,6 +214,7 @@ Product::Product(string _productId, ProductType _productType)
 {
     productId = _productId;
     productType = _productType;
+    id = NO_PRODUCT;
 }
 
 const string& Product::GetProductId() const
@@ -149,6 +227,11 @@ ProductType Product::GetProductType() const
     return productType;
 }
 
+ProductId Product::GetId() const
+{
+    return id;
+}
+
 
 //define member functions in class Bond
 Bond::Bond(string _productId, BondIdType _bondIdType, string _ticker, float _coupon, date _maturityDate) : Product(_productId, BOND)
@@ -183,6 +266,14 @@ BondIdType Bond::GetBondIdType() const
     return bondIdType;
 }
 
+MaturityBucket GetMaturityBucket(const date &maturityDate)
+{
+    int years=maturityDate.year()-MATURITY_BUCKET_BASE_YEAR;
+    if(years<=3) return FRONT_END;
+    if(years<=10) return BELLY;
+    return LONG_END;
+}
+
 ostream& operator<<(ostream &output, const Bond &bond)
 {
     output << bond.ticker << " " << bond.coupon << " " << bond.GetMaturityDate();
@@ -190,28 +281,80 @@ ostream& operator<<(ostream &output, const Bond &bond)
 }
 
 //define member funcions in class BondProductService
-void BondProductService::AddBond(Bond &bond)
+ProductId BondProductService::AddBond(const Bond &bond)
 {
-    bond_map.insert(std::make_pair(bond.GetProductId(), bond));
+    ProductId id=bond_table->Intern(bond);
+
+    //a bond added before, or interned by an event built from it, is only indexed once
+    if(id!=NO_PRODUCT && (id>=indexed.size() || !indexed[id])){
+        if(id>=indexed.size()) indexed.resize(id+1, false);
+        indexed[id]=true;
+        IndexBond(bond_table->Get(id));
+    }
+    return id;
 }
 
-Bond& BondProductService::GetData(std::string key)
+void BondProductService::IndexBond(const Bond &bond)
 {
-    return bond_map[key];
+    ticker_index[bond.GetTicker()].push_back(&bond);
+
+    //keep the sorted indexes sorted, a bond going after the ones equal to it
+    auto later_maturity=std::upper_bound(maturity_index.begin(), maturity_index.end(), &bond,
+            [](const Bond* a, const Bond* b){ return a->GetMaturityDate()<b->GetMaturityDate(); });
+    maturity_index.insert(later_maturity, &bond);
+
+    auto higher_coupon=std::upper_bound(coupon_index.begin(), coupon_index.end(), &bond,
+            [](const Bond* a, const Bond* b){ return a->GetCoupon()<b->GetCoupon(); });
+    coupon_index.insert(higher_coupon, &bond);
 }
 
-std::vector<Bond> BondProductService::GetBonds(const std::string& ticker) const
+const Bond& BondProductService::GetData(std::string key)
 {
-    //define a container to contain bond for specific requirment
-    std::vector<Bond> container;
+    ProductId id=NO_PRODUCT;
+    bond_table->Find(key, id);
+    return bond_table->Get(id);
+}
 
-    for(auto i:bond_map){
-        if(i.second.GetTicker()==ticker){
-            container.push_back(i.second);
-        }
+const Bond& BondProductService::GetData(ProductId id) const
+{
+    return bond_table->Get(id);
+}
+
+Span<const Bond*> BondProductService::GetBonds(const std::string& ticker) const
+{
+    auto it=ticker_index.find(ticker);
+    if(it==ticker_index.end()) return Span<const Bond*>();
+    return Span<const Bond*>(it->second.data(), it->second.size());
+}
+
+Span<const Bond*> BondProductService::GetBonds(MaturityBucket bucket) const
+{
+    //the buckets split at the start of the 4th and the 11th year after the base year
+    date frontEndEnd(MATURITY_BUCKET_BASE_YEAR+4, 1, 1);
+    date bellyEnd(MATURITY_BUCKET_BASE_YEAR+11, 1, 1);
+    switch(bucket){
+        case FRONT_END: return GetBondsMaturingBetween(date(boost::gregorian::min_date_time), frontEndEnd);
+        case BELLY: return GetBondsMaturingBetween(frontEndEnd, bellyEnd);
+        default: return GetBondsMaturingBetween(bellyEnd, date(boost::gregorian::max_date_time));
     }
+}
+
+Span<const Bond*> BondProductService::GetBondsMaturingBetween(const date& from, const date& to) const
+{
+    auto first=std::lower_bound(maturity_index.begin(), maturity_index.end(), from,
+            [](const Bond* a, const date& d){ return a->GetMaturityDate()<d; });
+    auto last=std::lower_bound(first, maturity_index.end(), to,
+            [](const Bond* a, const date& d){ return a->GetMaturityDate()<d; });
+    return Span<const Bond*>(maturity_index.data()+(first-maturity_index.begin()), last-first);
+}
 
-    return container;
+Span<const Bond*> BondProductService::GetBondsByCoupon(float low, float high) const
+{
+    auto first=std::lower_bound(coupon_index.begin(), coupon_index.end(), low,
+            [](const Bond* a, float c){ return a->GetCoupon()<c; });
+    auto last=std::upper_bound(first, coupon_index.end(), high,
+            [](float c, const Bond* a){ return c<a->GetCoupon(); });
+    return Span<const Bond*>(coupon_index.data()+(first-coupon_index.begin()), last-first);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,144 @@
+/**
+ * producttable.hpp
+ * Defines the securities table every product is interned in once, and the ProductId events carry instead of a copy.
+ *
+ * A Bond is a couple of strings, a float and a date; copying one into every Trade, OrderBook, Position, PV01,
+ * ExecutionOrder, PriceStream and Inquiry, and hashing or comparing its CUSIP again at every hop, costs more
+ * than the event itself. ProductTable<T> keeps each product once and hands out a 32-bit ProductId for it;
+ * events store the id and GetProduct() resolves it to the interned product by reference, an array lookup.
+ *
+ * Interning takes a mutex and is meant for start-up and for the first sight of a product. Get never locks:
+ * the table has a fixed capacity, so a product never moves once interned, and an id is only ever seen by a
+ * thread after the product behind it was stored.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef PRODUCT_TABLE_HPP
+#define PRODUCT_TABLE_HPP
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+// Id of an interned product
+typedef uint32_t ProductId;
+
+// Id of a product that was never interned
+const ProductId NO_PRODUCT = 0;
+
+// Number of products a table can hold
+const size_t PRODUCT_TABLE_CAPACITY = 1 << 16;
+
+/**
+ * The table of every product of type T, indexed by ProductId.
+ * Id NO_PRODUCT holds a default-constructed T, so an event without a product still resolves to one.
+ */
+template<typename T>
+class ProductTable
+{
+
+public:
+
+    // Generate instance
+    static ProductTable* Generate_Instance(){
+        static ProductTable ins;
+        return &ins;
+    }
+
+    // Intern a product, return its id; a product interned before, or a copy of one, keeps the id it had
+    ProductId Intern(const T &product);
+
+    // Find the id of a product by its product identifier, return false if it was never interned
+    bool Find(const std::string &productId, ProductId &id) const;
+
+    // Get the product of an id, the default product of NO_PRODUCT for an id never handed out
+    const T& Get(ProductId id) const;
+
+    // Get the number of ids handed out, NO_PRODUCT included
+    size_t GetCount() const;
+
+private:
+
+    // ctor storing the default product as NO_PRODUCT
+    ProductTable();
+
+    // a table cannot be copied
+    ProductTable(const ProductTable &) = delete;
+    ProductTable& operator=(const ProductTable &) = delete;
+
+    std::deque<T> store;                                // the products, which a deque never moves
+    std::unique_ptr<const T*[]> products;               // the product of each id, read without a lock
+    std::unordered_map<std::string, ProductId> ids;     // the id of each product identifier
+    std::atomic<size_t> count;
+    mutable std::mutex table_mutex;
+
+};
+
+
+
+//define member functions in class: ProductTable
+template<typename T>
+ProductTable<T>::ProductTable() :
+        products(new const T*[PRODUCT_TABLE_CAPACITY]()), count(0)
+{
+    store.push_back(T());
+    products[NO_PRODUCT] = &store.back();
+    count.store(1, std::memory_order_release);
+}
+
+template<typename T>
+ProductId ProductTable<T>::Intern(const T &product)
+{
+    if (product.GetId() != NO_PRODUCT) return product.GetId();
+
+    std::lock_guard<std::mutex> lock(table_mutex);
+    auto it = ids.find(product.GetProductId());
+    if (it != ids.end()) return it->second;
+
+    size_t next = count.load(std::memory_order_relaxed);
+    if (next == PRODUCT_TABLE_CAPACITY) {
+        std::cout << "product table is full, " << product.GetProductId() << " is not interned" << std::endl;
+        return NO_PRODUCT;
+    }
+
+    ProductId id = static_cast<ProductId>(next);
+    store.push_back(product);
+    store.back().id = id;
+    products[id] = &store.back();
+    ids.insert(std::make_pair(product.GetProductId(), id));
+    count.store(next + 1, std::memory_order_release);
+    return id;
+}
+
+template<typename T>
+bool ProductTable<T>::Find(const std::string &productId, ProductId &id) const
+{
+    std::lock_guard<std::mutex> lock(table_mutex);
+    auto it = ids.find(productId);
+    if (it == ids.end()) return false;
+    id = it->second;
+    return true;
+}
+
+template<typename T>
+const T& ProductTable<T>::Get(ProductId id) const
+{
+    //an id that was never handed out gets the default product rather than an empty slot
+    if (id >= count.load(std::memory_order_acquire)) return *products[NO_PRODUCT];
+    return *products[id];
+}
+
+template<typename T>
+size_t ProductTable<T>::GetCount() const
+{
+    return count.load(std::memory_order_acquire);
+}
+
+#endif
@@ -7,7 +7,9 @@
 #ifndef RISK_SERVICE_HPP
 #define RISK_SERVICE_HPP
 
+#include <mutex>
 #include "soa.h"
+#include "productindexedstore.h"
 #include "positionservice.h"
 
 /**
@@ -21,7 +23,7 @@ class PV01
 public:
 
     //ctor
-    PV01(){};
+    PV01() : productId(NO_PRODUCT), pv01(0), quantity(0), bucketedRisk() {};
 
     // ctor for a PV01 value
     PV01(const T &_product, double _pv01, long _quantity);
@@ -42,10 +44,17 @@ public:
         pv01 += pv01_new;
     }
 
+    // Get the total risk of a maturity bucket as it was when this risk was last updated
+    double GetBucketedRisk(MaturityBucket bucket) const;
+
+    // Set the total risk of every maturity bucket, RiskService does it each time it updates this risk
+    void SetBucketedRisk(const double *totals);
+
 private:
-    T product;
+    ProductId productId;    // the product, interned in ProductTable<T>
     double pv01;
     long quantity;
+    double bucketedRisk[MATURITY_BUCKET_COUNT];
 
 };
 
@@ -63,6 +72,9 @@ public:
     // ctor for a bucket sector
     BucketedSector(const vector<T> &_products, string _name);
 
+    // ctor for a bucket sector of the products a query of BondProductService returned
+    BucketedSector(Span<const T*> _products, string _name);
+
     // Get the products associated with this bucket
     const vector<T>& GetProducts() const;
 
@@ -89,11 +101,20 @@ private:
     //define listener
     std::vector<ServiceListener<PV01<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, PV01<Bond>> risk_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<PV01<Bond>> risk_data;
+
+    //the total risk of each maturity bucket, kept up to date as each product's risk changes
+    double bucket_risk[MATURITY_BUCKET_COUNT];
+
+    //guards risk_data and bucket_risk, which are updated and read from several threads when stages run behind an AsyncListener or ShardedListener
+    std::mutex risk_mutex;
 
     //ctor
-    RiskService(){};
+    RiskService() : bucket_risk() {};
+
+    // Move the total of the product's bucket from its old risk to its new one, and stamp the totals on it
+    void UpdateBucketedRisk(PV01<Bond> &risk, double old_risk);
 
 public:
 
@@ -108,9 +129,17 @@ public:
     void AddRisk(PV01<Bond> &rd);
 
     // Add a position that the service will risk
-    void AddPosition(Position<Bond> &position);
+    void AddPosition(const Position<Bond> &position);
+
+    // Add the position to its risk without notifying listeners, return the updated risk
+    PV01<Bond>& ApplyPosition(const Position<Bond> &position);
+
+    // Add a batch of positions (or snapshots of them) that the service will risk, the risk after each position is handed to each listener at once
+    template<typename Item>
+    void AddPositionBatch(const Item *positions, size_t count);
 
     // Get the bucketed risk for the bucket sector
+    // It merges the risk of every product in the sector under the lock, whichever shard each product is risked on
     double GetBucketedRisk(const BucketedSector<Bond> &sector);
 
     // pure virtual member functions in class Service.
@@ -167,6 +196,15 @@ public:
     // Listener callback to process an update event to the Service
     void ProcessUpdate(Position<Bond> &data) ;
 
+    // Listener callback to process a batch of add events to the Service
+    void ProcessAddBatch(Position<Bond> *data, size_t count) ;
+
+    // Listener callback to process an add event shared as a snapshot
+    void ProcessAddSnapshot(const Snapshot<Position<Bond>> &data) ;
+
+    // Listener callback to process a batch of add events shared as snapshots
+    void ProcessAddSnapshotBatch(const Snapshot<Position<Bond>> *data, size_t count) ;
+
     // return position service
     RiskService* GetRiskService();
 };
@@ -176,7 +214,7 @@ public:
 //define member functions in class: PV01
 template<typename T>
 PV01<T>::PV01(const T &_product, double _pv01, long _quantity) :
-        product(_product)
+        productId(ProductTable<T>::Generate_Instance()->Intern(_product)), bucketedRisk()
 {
     pv01 = _pv01;
     quantity = _quantity;
@@ -185,7 +223,7 @@ PV01<T>::PV01(const T &_product, double _pv01, long _quantity) :
 template<typename T>
 const T& PV01<T>::GetProduct() const
 {
-    return product;
+    return ProductTable<T>::Generate_Instance()->Get(productId);
 }
 
 template<typename T>
@@ -206,6 +244,20 @@ void PV01<T>::AddQuant(long quantity_new)
     quantity+=quantity_new;
 }
 
+template<typename T>
+double PV01<T>::GetBucketedRisk(MaturityBucket bucket) const
+{
+    return bucketedRisk[bucket];
+}
+
+template<typename T>
+void PV01<T>::SetBucketedRisk(const double *totals)
+{
+    for(int i=0;i<MATURITY_BUCKET_COUNT;++i){
+        bucketedRisk[i]=totals[i];
+    }
+}
+
 
 //define member functions in class: BucketSector
 template<typename T>
@@ -221,6 +273,15 @@ const vector<T>& BucketedSector<T>::GetProducts() const
     return products;
 }
 
+template<typename T>
+BucketedSector<T>::BucketedSector(Span<const T*> _products, string _name) :
+        name(_name)
+{
+    for(const T* product: _products){
+        products.push_back(*product);
+    }
+}
+
 template<typename T>
 const string& BucketedSector<T>::GetName() const
 {
@@ -231,16 +292,25 @@ const string& BucketedSector<T>::GetName() const
 //define member functions in class: RiskService
 void RiskService::AddRisk(PV01<Bond> &rd)
 {
-    risk_data.insert(std::make_pair(rd.GetProduct().GetProductId(),rd));
+    std::lock_guard<std::mutex> lock(risk_mutex);
+    auto inserted=risk_data.Insert(rd.GetProduct().GetId(),rd);
+    if(inserted.second){
+        UpdateBucketedRisk(*inserted.first, 0);
+    }
 }
 
-void RiskService::AddPosition(Position<Bond> &position)
+void RiskService::UpdateBucketedRisk(PV01<Bond> &risk, double old_risk)
 {
-    // Add positions to the service
+    //the same positive total GetBucketedRisk sums, so the running totals match it
+    double new_risk=risk.GetPV01()* (-risk.GetQuantity());
+    bucket_risk[GetMaturityBucket(risk.GetProduct().GetMaturityDate())]+=new_risk-old_risk;
+    risk.SetBucketedRisk(bucket_risk);
+}
 
-    //firstly, making the positions stored
+PV01<Bond>& RiskService::ApplyPosition(const Position<Bond> &position)
+{
     //Once a position made, we add the amount of positions in our risk analysis
-    std::string productId=position.GetProduct().GetProductId();
+    ProductId productId=position.GetProduct().GetId();
 
     //define quantity of the position
     long quantity_of_position=position.GetAggregatePosition();
@@ -248,32 +318,66 @@ void RiskService::AddPosition(Position<Bond> &position)
     long new_risk = rand() % 100;
 
     //store the position
-    if(risk_data.find(productId)->first==productId){
+    std::lock_guard<std::mutex> lock(risk_mutex);
+    PV01<Bond>* risk=risk_data.Find(productId);
+    if(risk){
         //If we can find the key of risk_data, then just add the quantity
-        risk_data[productId].AddPV01(new_risk);
-        risk_data[productId].AddQuant(quantity_of_position);
+        double old_risk=risk->GetPV01()* (-risk->GetQuantity());
+        risk->AddPV01(new_risk);
+        risk->AddQuant(quantity_of_position);
+
+        //the risk carries the bucket totals as of this position, whichever thread writes it out later
+        UpdateBucketedRisk(*risk, old_risk);
+        return *risk;
     }
 
+    return risk_data[productId];
+}
+
+void RiskService::AddPosition(const Position<Bond> &position)
+{
+    // Add positions to the service
+
+    //firstly, making the positions stored, the risk after it is snapshotted once and shared by every listener
+    Snapshot<PV01<Bond>> pv(ApplyPosition(position));
+
     //pass the trade data to listeners
-    std::cout<<"data goes from RiskService -> listener."<<std::endl;
-    PV01<Bond> pv=risk_data[productId];
+    LOG_TRACE("data goes from RiskService -> listener.");
+    for(auto& l: listeners){
+        l->ProcessAddSnapshot(pv);
+    }
+}
+
+template<typename Item>
+void RiskService::AddPositionBatch(const Item *positions, size_t count)
+{
+    //firstly, making the positions stored and snapshot the risk after each of them
+    std::vector<Snapshot<PV01<Bond>>> risk_batch;
+    risk_batch.reserve(count);
+    for(size_t i=0;i<count;++i){
+        risk_batch.push_back(Snapshot<PV01<Bond>>(ApplyPosition(SnapshotValue(positions[i]))));
+    }
+
+    //pass the risks to listeners
+    LOG_TRACE("data goes from RiskService -> listener. (%lu risks)", count);
     for(auto& l: listeners){
-        l->ProcessAdd(pv);
+        l->ProcessAddSnapshotBatch(risk_batch.data(), risk_batch.size());
     }
 }
 
 double RiskService::GetBucketedRisk(const BucketedSector<Bond> &sector)
 {
-    std::vector<std::string> cuips;
+    std::vector<ProductId> cuips;
     double sum_pv01=0;
 
     //go through each product in bucket sector and add the risk together
-    for(auto l:sector.GetProducts()){
-        cuips.push_back(l.GetProductId());
+    for(auto& l:sector.GetProducts()){
+        cuips.push_back(ProductTable<Bond>::Generate_Instance()->Intern(l));
     }
 
+    std::lock_guard<std::mutex> lock(risk_mutex);
     for(auto& ss:cuips){
-        auto it=risk_data[ss];
+        auto& it=risk_data[ss];
 
         //we want a positive total risk
         sum_pv01+=it.GetPV01()* (-it.GetQuantity()); //we use minus of PV01's quantity since if it is BUY, then quantity will be negative.
@@ -284,7 +388,7 @@ double RiskService::GetBucketedRisk(const BucketedSector<Bond> &sector)
 
 PV01<Bond>& RiskService::GetData(std::string key) 
 {
-    return risk_data.at(key);
+    return risk_data.At(key);
 }
 
 void RiskService::OnMessage(PV01<Bond> &data) 
@@ -309,6 +413,24 @@ void RiskServiceListener::ProcessAdd(Position<Bond> &data)
     risk_service->AddPosition(data);
 }
 
+// Listener callback to process a batch of add events to the Service
+void RiskServiceListener::ProcessAddBatch(Position<Bond> *data, size_t count)
+{
+    risk_service->AddPositionBatch(data, count);
+}
+
+// Listener callback to process an add event shared as a snapshot
+void RiskServiceListener::ProcessAddSnapshot(const Snapshot<Position<Bond>> &data)
+{
+    risk_service->AddPosition(*data);
+}
+
+// Listener callback to process a batch of add events shared as snapshots
+void RiskServiceListener::ProcessAddSnapshotBatch(const Snapshot<Position<Bond>> *data, size_t count)
+{
+    risk_service->AddPositionBatch(data, count);
+}
+
 // Listener callback to process a remove event to the Service
 void RiskServiceListener::ProcessRemove(Position<Bond> &data) 
 {
@@ -0,0 +1,329 @@
+/**
+ * securitiesmaster.hpp
+ * Defines the securities master: the reference data of every bond, read once from bonds.txt.
+ *
+ * Each line of the file is CUSIP,Ticker,Coupon,Maturity,IdType[,DayCount], e.g.
+ *     912828F62,T,0.015,2019-10-31,CUSIP,ACT/ACT
+ * Load reads the file the first time it is called and does nothing after that. Every bond is added to
+ * BondProductService, which interns and indexes it, and gets its BondStatics worked out once: the coupon
+ * schedule and cashflows after settlement, the day count and the accrual period settlement falls in.
+ * Bonds and statics are then looked up by ProductId in O(1), or by CUSIP through the product table.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef SECURITIES_MASTER_HPP
+#define SECURITIES_MASTER_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+#include <stdexcept>
+#include "boost/utility/string_view.hpp"
+#include "products.h"
+#include "productindexedstore.h"
+#include "csvreader.h"
+#include "parsestats.h"
+
+using namespace std;
+
+// File the securities master is read from by default
+const char SECURITIES_MASTER_FILE[] = "../input/bonds.txt";
+
+// Date the statics are worked out for: accrued interest, the remaining coupons and time to maturity
+const date SECURITIES_SETTLEMENT_DATE(2017, 12, 15);
+
+// Coupons a bond pays a year
+const int COUPONS_PER_YEAR = 2;
+
+// Day count conventions of the accrual period
+enum DayCount { ACT_ACT, THIRTY_360 };
+
+// Parse a date written as YYYY-MM-DD
+ParseResult ParseDate(boost::string_view s, date &value);
+
+// Parse a coupon written as a decimal fraction, like 0.0175
+ParseResult ParseCoupon(boost::string_view s, float &coupon);
+
+// Parse an identifier type written as CUSIP or ISIN
+ParseResult ParseBondIdType(boost::string_view s, BondIdType &type);
+
+// Parse a day count written as ACT/ACT or 30/360
+ParseResult ParseDayCount(boost::string_view s, DayCount &dayCount);
+
+/**
+ * What never changes about a bond once it is loaded, per 100 of face value.
+ */
+struct BondStatics
+{
+    DayCount dayCount;
+    double couponPayment;           // paid on each coupon date
+    std::vector<date> couponDates;  // every coupon date after settlement, the last one is maturity
+    std::vector<double> cashflows;  // paid on each coupon date, the last one with the principal
+    date previousCoupon;            // start of the accrual period settlement falls in
+    long accrualDays;               // days accrued from previousCoupon to settlement
+    long periodDays;                // days in the accrual period, the basis of accrued interest
+    double accruedInterest;         // accrued at settlement
+    double yearsToMaturity;
+};
+
+/**
+ * SecuritiesMaster loads the bonds once and serves them and their statics.
+ */
+class SecuritiesMaster
+{
+
+public:
+
+    // Generate instance
+    static SecuritiesMaster* Generate_Instance(){
+        static SecuritiesMaster ins;
+        return &ins;
+    }
+
+    // Read the bonds from path the first time it is called, return the number of bonds loaded
+    size_t Load(const std::string &path = SECURITIES_MASTER_FILE);
+
+    // Whether the bonds have been loaded
+    bool IsLoaded() const;
+
+    // Get the ids of the bonds, in the order of the file
+    const std::vector<ProductId>& GetProductIds() const;
+
+    // Get a bond by its CUSIP, the default bond if there is none
+    const Bond& GetBond(const std::string &cusip) const;
+
+    // Get a bond by its id
+    const Bond& GetBond(ProductId id) const;
+
+    // Get the statics of a bond, throw std::out_of_range if it was not loaded
+    const BondStatics& GetStatics(ProductId id) const;
+    const BondStatics& GetStatics(const std::string &cusip) const;
+
+    // Get the counters of the lines read
+    const ParseStats& GetParseStats() const;
+
+private:
+
+    // ctor
+    SecuritiesMaster() : loaded(false) {}
+
+    // Add the bond on a line, return PARSE_OK or why the line was skipped
+    ParseErrc LoadLine(boost::string_view line);
+
+    // Work out the statics of a bond
+    BondStatics ComputeStatics(const Bond &bond, DayCount dayCount) const;
+
+    ProductIndexedStore<BondStatics> statics;
+    std::vector<ProductId> ids;
+    ParseStats stats;
+    std::atomic<bool> loaded;
+    std::mutex load_mutex;
+
+};
+
+
+
+ParseResult ParseDate(boost::string_view s, date &value)
+{
+    //YYYY-MM-DD, each part must be all digits
+    if (s.empty()) return ParseResult{s.data(), PARSE_EMPTY_FIELD};
+    if (s.size() != 10 || s[4] != '-' || s[7] != '-') return ParseResult{s.data(), PARSE_INVALID_CHARACTER};
+
+    long year = 0, month = 0, day = 0;
+    ParseResult r = ParseLong(s.substr(0, 4), year);
+    if (r.ec == PARSE_OK) r = ParseLong(s.substr(5, 2), month);
+    if (r.ec == PARSE_OK) r = ParseLong(s.substr(8, 2), day);
+    if (r.ec != PARSE_OK) return r;
+
+    //check the range ourselves, boost would throw
+    if (year < 1400 || year > 9999 || month < 1 || month > 12 || day < 1 ||
+        day > gregorian_calendar::end_of_month_day(static_cast<unsigned short>(year), static_cast<unsigned short>(month))) {
+        return ParseResult{s.data(), PARSE_OUT_OF_RANGE};
+    }
+
+    value = date(static_cast<unsigned short>(year), static_cast<unsigned short>(month), static_cast<unsigned short>(day));
+    return ParseResult{s.data() + s.size(), PARSE_OK};
+}
+
+ParseResult ParseCoupon(boost::string_view s, float &coupon)
+{
+    if (s.empty()) return ParseResult{s.data(), PARSE_EMPTY_FIELD};
+
+    //fields are short, copy one out so strtof stops at its end
+    char buffer[32];
+    if (s.size() >= sizeof(buffer)) return ParseResult{s.data(), PARSE_OUT_OF_RANGE};
+    s.copy(buffer, s.size());
+    buffer[s.size()] = '\0';
+
+    char* end = nullptr;
+    float value = std::strtof(buffer, &end);
+    if (end != buffer + s.size()) return ParseResult{s.data() + (end - buffer), PARSE_INVALID_CHARACTER};
+    if (value < 0 || value >= 1) return ParseResult{s.data(), PARSE_OUT_OF_RANGE};
+
+    coupon = value;
+    return ParseResult{s.data() + s.size(), PARSE_OK};
+}
+
+ParseResult ParseBondIdType(boost::string_view s, BondIdType &type)
+{
+    if (s.empty()) return ParseResult{s.data(), PARSE_EMPTY_FIELD};
+    if (s == "CUSIP") type = CUSIP;
+    else if (s == "ISIN") type = ISIN;
+    else return ParseResult{s.data(), PARSE_UNKNOWN_VALUE};
+    return ParseResult{s.data() + s.size(), PARSE_OK};
+}
+
+ParseResult ParseDayCount(boost::string_view s, DayCount &dayCount)
+{
+    if (s.empty()) return ParseResult{s.data(), PARSE_EMPTY_FIELD};
+    if (s == "ACT/ACT") dayCount = ACT_ACT;
+    else if (s == "30/360") dayCount = THIRTY_360;
+    else return ParseResult{s.data(), PARSE_UNKNOWN_VALUE};
+    return ParseResult{s.data() + s.size(), PARSE_OK};
+}
+
+
+
+//define member functions in class: SecuritiesMaster
+size_t SecuritiesMaster::Load(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(load_mutex);
+    if (loaded) return ids.size();
+
+    stats = ParseStats(path);
+    MappedFile file(path);
+    if (!file.IsOpen()) {
+        std::cout << path << " cannot be opened!" << std::endl;
+        return 0;
+    }
+
+    CsvLineReader reader(file.Begin(), file.End());
+    reader.NextLine(); //skip the header
+
+    //add every line, bad lines are skipped and counted
+    while (reader.NextLine()) {
+        if (!reader.GetLine().empty()) {
+            stats.CountLine(LoadLine(reader.GetLine()));
+        }
+    }
+
+    std::cout << stats << std::endl;
+    loaded = true;
+    return ids.size();
+}
+
+ParseErrc SecuritiesMaster::LoadLine(boost::string_view line)
+{
+    //split the line into CUSIP, ticker, coupon, maturity, id type and the optional day count
+    boost::string_view fields[6];
+    CsvLineReader reader(line.data(), line.data() + line.size());
+    reader.NextLine();
+    size_t count = reader.Split(fields, 6);
+    if (count < 5) return PARSE_MISSING_FIELDS;
+    if (fields[0].empty() || fields[1].empty()) return PARSE_EMPTY_FIELD;
+
+    float coupon = 0;
+    date maturity;
+    BondIdType idType = CUSIP;
+    DayCount dayCount = ACT_ACT;
+    ParseResult r = ParseCoupon(fields[2], coupon);
+    if (r.ec == PARSE_OK) r = ParseDate(fields[3], maturity);
+    if (r.ec == PARSE_OK) r = ParseBondIdType(fields[4], idType);
+    if (r.ec == PARSE_OK && count == 6) r = ParseDayCount(fields[5], dayCount);
+    if (r.ec != PARSE_OK) return r.ec;
+
+    //a CUSIP already loaded keeps its first line
+    Bond bond(std::string(fields[0].data(), fields[0].size()), idType, std::string(fields[1].data(), fields[1].size()), coupon, maturity);
+    ProductId id = BondProductService::Generate_Instance()->AddBond(bond);
+    if (id == NO_PRODUCT) return PARSE_OUT_OF_RANGE;
+    if (statics.Insert(id, ComputeStatics(GetBond(id), dayCount)).second) {
+        ids.push_back(id);
+    }
+    return PARSE_OK;
+}
+
+BondStatics SecuritiesMaster::ComputeStatics(const Bond &bond, DayCount dayCount) const
+{
+    BondStatics s;
+    s.dayCount = dayCount;
+    s.couponPayment = 100.0 * bond.GetCoupon() / COUPONS_PER_YEAR;
+
+    //step back from maturity one period at a time, each date from maturity itself so month ends stay month ends
+    const date& maturity = bond.GetMaturityDate();
+    int monthsPerPeriod = 12 / COUPONS_PER_YEAR;
+    date previous = maturity;
+    for (int k = 0; ; ++k) {
+        date d = maturity - months(monthsPerPeriod * k);
+        if (d <= SECURITIES_SETTLEMENT_DATE) {
+            previous = d;
+            break;
+        }
+        s.couponDates.push_back(d);
+    }
+    std::reverse(s.couponDates.begin(), s.couponDates.end());
+
+    for (size_t i = 0; i < s.couponDates.size(); ++i) {
+        s.cashflows.push_back(s.couponPayment + (i + 1 == s.couponDates.size() ? 100.0 : 0.0));
+    }
+
+    //accrued interest over the period settlement falls in, none once the bond has matured
+    s.previousCoupon = previous;
+    date next = s.couponDates.empty() ? previous : s.couponDates.front();
+    if (dayCount == THIRTY_360) {
+        auto days360 = [](const date& a, const date& b) {
+            int d1 = std::min<int>(a.day(), 30);
+            int d2 = (d1 == 30) ? std::min<int>(b.day(), 30) : static_cast<int>(b.day());
+            return 360L * (b.year() - a.year()) + 30L * (b.month() - a.month()) + (d2 - d1);
+        };
+        s.accrualDays = days360(previous, SECURITIES_SETTLEMENT_DATE);
+        s.periodDays = 360 / COUPONS_PER_YEAR;
+    }
+    else {
+        s.accrualDays = (SECURITIES_SETTLEMENT_DATE - previous).days();
+        s.periodDays = (next - previous).days();
+    }
+    s.accruedInterest = (s.couponDates.empty() || s.periodDays <= 0) ? 0.0 : s.couponPayment * s.accrualDays / s.periodDays;
+    s.yearsToMaturity = std::max(0.0, (maturity - SECURITIES_SETTLEMENT_DATE).days() / 365.25);
+    return s;
+}
+
+bool SecuritiesMaster::IsLoaded() const
+{
+    return loaded;
+}
+
+const std::vector<ProductId>& SecuritiesMaster::GetProductIds() const
+{
+    return ids;
+}
+
+const Bond& SecuritiesMaster::GetBond(const std::string &cusip) const
+{
+    return BondProductService::Generate_Instance()->GetData(cusip);
+}
+
+const Bond& SecuritiesMaster::GetBond(ProductId id) const
+{
+    return BondProductService::Generate_Instance()->GetData(id);
+}
+
+const BondStatics& SecuritiesMaster::GetStatics(ProductId id) const
+{
+    return statics.At(id);
+}
+
+const BondStatics& SecuritiesMaster::GetStatics(const std::string &cusip) const
+{
+    return statics.At(GetBond(cusip).GetId());
+}
+
+const ParseStats& SecuritiesMaster::GetParseStats() const
+{
+    return stats;
+}
+
+#endif
@@ -0,0 +1,442 @@
+/**
+ * servicegraph.hpp
+ * Defines a graph of services built from a config file instead of being wired by hand in main().
+ *
+ * Each line of the config names a path and the services it goes through, e.g.
+ *     Path2: TradeBookingService -> PositionService -> RiskService -> BondHistoricalPV01Service
+ * Blank lines and lines starting with # are skipped. Every path must start at a source, a service fed by a
+ * connector (TradeBookingService, PricingService, MarketDataService, BondInquiryService).
+ *
+ * Paths that share a hop, such as Path1 and Path2 both going TradeBookingService -> PositionService,
+ * share the services on it: the listener is registered once, so every trade is booked and positioned once
+ * for both paths. Each source then reads its input on its own thread of a ThreadPool, so trades, prices,
+ * market data and inquiries all go through the graph at the same time.
+ *
+ * A hop can be given its own thread behind a bounded queue (edgequeue.h) with a line such as
+ *     Edge: BondStreamingService -> BondHistoricalStreamingService drop_oldest 4096
+ * where the policy is block, drop_oldest or conflate and the capacity is optional. With
+ *     Edge: PricingService -> BondGuiService latest 256 1000
+ * the hop only passes on the latest event of each of up to 256 products, at most once every 1000 microseconds
+ * (conflatinglistener.h). The metrics of every such edge are printed once all the sources are exhausted.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef SERVICE_GRAPH_HPP
+#define SERVICE_GRAPH_HPP
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+#include <typeindex>
+#include <typeinfo>
+#include <chrono>
+#include <mutex>
+#include <algorithm>
+#include "soa.h"
+#include "threadpool.h"
+#include "asynclistener.h"
+#include "conflatinglistener.h"
+#include "tradebookingservice.h"
+#include "positionservice.h"
+#include "riskservice.h"
+#include "pricingservice.h"
+#include "marketdataservice.h"
+#include "algoexecutionservice.h"
+#include "bondexecutionservice.h"
+#include "algostreamingservice.h"
+#include "bondstreamingservice.h"
+#include "inquiryservice.h"
+#include "guiservice.h"
+#include "historicaldataservice.h"
+
+using namespace std;
+
+// Config the graph is built from by default
+const char SERVICE_GRAPH_DEFAULT_CONFIG[] = "../servicegraph.txt";
+
+// Get the type of data a service hands to its listeners, from its AddListener
+template<typename S, typename V>
+V ServiceOutputOf(void (S::*addListener)(ServiceListener<V>*));
+
+// Get the type of data a listener takes, from its ProcessAdd
+template<typename L, typename V>
+V ListenerInputOf(void (L::*processAdd)(V&));
+
+/**
+ * A graph of services and the paths through them.
+ */
+class ServiceGraph
+{
+
+public:
+
+    // ctor registering every bond service the config can name
+    ServiceGraph();
+
+    // Register a service with the listener that feeds it
+    template<typename S, typename L>
+    void AddService(const std::string &name);
+
+    // Register a service fed by a connector; start and stop run around subscribe
+    template<typename S>
+    void AddSource(const std::string &name, std::function<void()> subscribe,
+                   std::function<void()> start = std::function<void()>(), std::function<void()> stop = std::function<void()>());
+
+    // Read the paths from a config file, return false if it cannot be read or a path is not valid
+    bool Load(const std::string &path = SERVICE_GRAPH_DEFAULT_CONFIG);
+
+    // Register the listeners of every path, each hop once however many paths go through it
+    bool Build();
+
+    // Read every source of the graph on a pool of threadCount threads, return when all of them are exhausted
+    void Run(size_t threadCount);
+
+    // Get the sources the paths start at, in the order they first appear
+    const std::vector<std::string>& GetSources() const;
+
+    // Get the paths through a service
+    std::vector<std::string> GetPathsThrough(const std::string &name) const;
+
+    // Print the metrics of every hop that runs behind a queue
+    void PrintEdgeMetrics() const;
+
+private:
+
+    // a service as the graph sees it, with the types on either side of it
+    struct Node
+    {
+        std::type_index input;
+        std::type_index output;
+        std::function<void*()> listener;            // the ServiceListener<input> feeding it
+        std::function<void(void*)> addListener;     // register a ServiceListener<output> on it
+        std::function<void()> subscribe;            // read its input, only for a source
+        std::function<void()> start;
+        std::function<void()> stop;
+        std::function<AsyncStage*(OverflowPolicy, size_t, void*&)> async;   // wrap its listener in an AsyncListener
+        std::function<AsyncStage*(size_t, std::chrono::microseconds, void*&)> latest;  // or in a ConflatingListener
+    };
+
+    // a hop given its own thread in the config
+    struct EdgeConfig
+    {
+        bool latest;                        // a ConflatingListener instead of a queue
+        OverflowPolicy policy;
+        size_t capacity;                    // events queued, or products with a slot
+        std::chrono::microseconds interval; // how long a ConflatingListener waits between drains
+    };
+
+    struct AsyncEdge
+    {
+        std::string from;
+        std::string to;
+        std::string source;                 // the source whose task stops it
+        std::unique_ptr<AsyncStage> stage;
+    };
+
+    // Read an Edge line of the config
+    bool LoadEdge(const std::string &path, int lineNumber, std::stringstream &rest);
+
+    struct Path
+    {
+        std::string name;
+        std::vector<std::string> services;
+    };
+
+    std::map<std::string, Node> nodes;
+    std::vector<Path> paths;
+    std::vector<std::string> sources;
+    std::set<std::pair<std::string, std::string>> edges;
+    std::map<std::pair<std::string, std::string>, EdgeConfig> edgeConfigs;
+    std::vector<AsyncEdge> asyncEdges;
+    std::mutex report_mutex;
+
+};
+
+
+
+//define member functions in class: ServiceGraph
+ServiceGraph::ServiceGraph()
+{
+    //sources, each read by its connector
+    AddSource<TradeBookingService>("TradeBookingService", []{ TradeBookingConnector::Generate_Instance()->Subscribe(); });
+    AddSource<PricingService>("PricingService", []{ PricingServiceConnector::Generate_Instance()->Subscribe(); },
+                              []{ PricingService::Generate_Instance()->StartMulticast(); },
+                              []{ PricingService::Generate_Instance()->StopMulticast(); });
+    AddSource<MarketDataService>("MarketDataService", []{ MarketDataConnector::Generate_Instance()->Subscribe(); });
+    AddSource<BondInquiryService>("BondInquiryService", []{ BondInquiryServiceConnector::Generate_Instance()->Subscribe(); });
+
+    //services fed by a listener
+    AddService<PositionService, PositionServiceListener>("PositionService");
+    AddService<RiskService, RiskServiceListener>("RiskService");
+    AddService<BondGuiService, BondGuiServiceListener>("BondGuiService");
+    AddService<AlgoStreamingService, AlgoStreamingServiceListener>("AlgoStreamingService");
+    AddService<BondStreamingService, BondStreamingServiceListener>("BondStreamingService");
+    AddService<AlgoExecutionService, AlgoExecutionServiceListener>("AlgoExecutionService");
+    AddService<BondExecutionService, BondExecutionServiceListener>("BondExecutionService");
+    AddService<BondHistoricalPositionService, BondHistoricalPositionServiceListener>("BondHistoricalPositionService");
+    AddService<BondHistoricalPV01Service, BondHistoricalPV01ServiceListener>("BondHistoricalPV01Service");
+    AddService<BondHistoricalStreamingService, BondHistoricalStreamingServiceListener>("BondHistoricalStreamingService");
+    AddService<BondHistoricalExecutionService, BondHistoricalExecutionServiceListener>("BondHistoricalExecutionService");
+    AddService<BondHistoricalInquiryService, BondHistoricalInquiryServiceListener>("BondHistoricalInquiryService");
+}
+
+template<typename S, typename L>
+void ServiceGraph::AddService(const std::string &name)
+{
+    typedef decltype(ServiceOutputOf(&S::AddListener)) Output;
+    typedef decltype(ListenerInputOf(&L::ProcessAdd)) Input;
+
+    Node node{std::type_index(typeid(Input)), std::type_index(typeid(Output)),
+              []{ return static_cast<void*>(static_cast<ServiceListener<Input>*>(L::Generate_Instance())); },
+              [](void* listener){ S::Generate_Instance()->AddListener(static_cast<ServiceListener<Output>*>(listener)); },
+              std::function<void()>(), std::function<void()>(), std::function<void()>(),
+              [](OverflowPolicy policy, size_t capacity, void*& listener) -> AsyncStage* {
+                  AsyncListener<Input>* async=new AsyncListener<Input>(L::Generate_Instance(), capacity, DEFAULT_BATCH_SIZE, policy);
+                  listener=static_cast<void*>(static_cast<ServiceListener<Input>*>(async));
+                  return async;
+              },
+              [](size_t slotCount, std::chrono::microseconds interval, void*& listener) -> AsyncStage* {
+                  ConflatingListener<Input>* latest=new ConflatingListener<Input>(L::Generate_Instance(), slotCount, DEFAULT_BATCH_SIZE, interval);
+                  listener=static_cast<void*>(static_cast<ServiceListener<Input>*>(latest));
+                  return latest;
+              }};
+    nodes.insert(std::make_pair(name, node));
+}
+
+template<typename S>
+void ServiceGraph::AddSource(const std::string &name, std::function<void()> subscribe, std::function<void()> start, std::function<void()> stop)
+{
+    typedef decltype(ServiceOutputOf(&S::AddListener)) Output;
+
+    Node node{std::type_index(typeid(void)), std::type_index(typeid(Output)),
+              std::function<void*()>(),
+              [](void* listener){ S::Generate_Instance()->AddListener(static_cast<ServiceListener<Output>*>(listener)); },
+              subscribe, start, stop, std::function<AsyncStage*(OverflowPolicy, size_t, void*&)>(),
+              std::function<AsyncStage*(size_t, std::chrono::microseconds, void*&)>()};
+    nodes.insert(std::make_pair(name, node));
+}
+
+bool ServiceGraph::Load(const std::string &path)
+{
+    ifstream in(path);
+    if(!in.is_open()){
+        std::cout<<path<<" cannot be opened!"<<std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber=0;
+    while(getline(in, line)){
+        ++lineNumber;
+        size_t first=line.find_first_not_of(" \t\r");
+        if(first==std::string::npos || line[first]=='#') continue;
+
+        //a path is its name, a colon, then the services separated by arrows
+        size_t colon=line.find(':');
+        if(colon==std::string::npos){
+            std::cout<<path<<":"<<lineNumber<<": a path needs a name followed by ':'"<<std::endl;
+            return false;
+        }
+        Path p;
+        std::stringstream name(line.substr(0, colon));
+        name>>p.name;
+
+        std::stringstream rest(line.substr(colon+1));
+        if(p.name=="Edge"){
+            if(!LoadEdge(path, lineNumber, rest)) return false;
+            continue;
+        }
+
+        std::string token;
+        bool arrow=true;
+        while(rest>>token){
+            if(token=="->"){
+                arrow=true;
+                continue;
+            }
+            if(!arrow){
+                std::cout<<path<<":"<<lineNumber<<": '->' missing before "<<token<<std::endl;
+                return false;
+            }
+            if(nodes.find(token)==nodes.end()){
+                std::cout<<path<<":"<<lineNumber<<": unknown service "<<token<<std::endl;
+                return false;
+            }
+            p.services.push_back(token);
+            arrow=false;
+        }
+
+        //a path has to start where data comes in and every hop has to pass the type the next service takes
+        if(p.services.empty() || !nodes.at(p.services.front()).subscribe){
+            std::cout<<path<<":"<<lineNumber<<": "<<p.name<<" does not start at a source"<<std::endl;
+            return false;
+        }
+        for(size_t i=1;i<p.services.size();++i){
+            const Node& from=nodes.at(p.services[i-1]);
+            const Node& to=nodes.at(p.services[i]);
+            if(!to.listener || from.output!=to.input){
+                std::cout<<path<<":"<<lineNumber<<": "<<p.services[i-1]<<" cannot feed "<<p.services[i]<<std::endl;
+                return false;
+            }
+        }
+
+        if(std::find(sources.begin(), sources.end(), p.services.front())==sources.end()){
+            sources.push_back(p.services.front());
+        }
+        paths.push_back(p);
+    }
+    return true;
+}
+
+bool ServiceGraph::LoadEdge(const std::string &path, int lineNumber, std::stringstream &rest)
+{
+    std::string from, arrow, to, policyName;
+    if(!(rest>>from>>arrow>>to>>policyName) || arrow!="->"){
+        std::cout<<path<<":"<<lineNumber<<": an edge is 'Edge: <service> -> <service> <policy> [capacity]'"<<std::endl;
+        return false;
+    }
+
+    EdgeConfig config={policyName=="latest", BLOCK_PRODUCER, ASYNC_QUEUE_DEFAULT_CAPACITY, std::chrono::microseconds(0)};
+    if(config.latest){
+        //latest [products] [microseconds between drains]
+        size_t slotCount;
+        long interval;
+        config.capacity=CONFLATING_DEFAULT_SLOTS;
+        if(rest>>slotCount) config.capacity=slotCount;
+        if(rest>>interval) config.interval=std::chrono::microseconds(interval);
+    }
+    else if(!ParsePolicy(policyName, config.policy)){
+        std::cout<<path<<":"<<lineNumber<<": unknown policy "<<policyName<<", use block, drop_oldest, conflate or latest"<<std::endl;
+        return false;
+    }
+    else if(!(rest>>config.capacity)){
+        config.capacity=ASYNC_QUEUE_DEFAULT_CAPACITY;
+    }
+
+    if(nodes.find(to)==nodes.end() || !nodes.at(to).async){
+        std::cout<<path<<":"<<lineNumber<<": "<<to<<" cannot run behind a queue"<<std::endl;
+        return false;
+    }
+
+    edgeConfigs[std::make_pair(from, to)]=config;
+    return true;
+}
+
+bool ServiceGraph::Build()
+{
+    for(auto& p: paths){
+        for(size_t i=1;i<p.services.size();++i){
+            auto edge=std::make_pair(p.services[i-1], p.services[i]);
+
+            //a hop another path already has is not registered again, or its data would go through twice
+            if(!edges.insert(edge).second) continue;
+
+            auto config=edgeConfigs.find(edge);
+            if(config==edgeConfigs.end()){
+                nodes.at(edge.first).addListener(nodes.at(edge.second).listener());
+                continue;
+            }
+
+            //the hop gets its own thread, stopped by the task of the path's source once that has run dry
+            void* listener=nullptr;
+            AsyncEdge async;
+            async.from=edge.first;
+            async.to=edge.second;
+            async.source=p.services.front();
+            const EdgeConfig& c=config->second;
+            if(c.latest){
+                async.stage.reset(nodes.at(edge.second).latest(c.capacity, c.interval, listener));
+            }
+            else{
+                async.stage.reset(nodes.at(edge.second).async(c.policy, c.capacity, listener));
+            }
+            nodes.at(edge.first).addListener(listener);
+            asyncEdges.push_back(std::move(async));
+        }
+    }
+
+    for(auto& config: edgeConfigs){
+        if(edges.find(config.first)==edges.end()){
+            std::cout<<"no path goes "<<config.first.first<<" -> "<<config.first.second<<", its Edge line is not used"<<std::endl;
+        }
+    }
+
+    //say which services the paths share
+    std::set<std::string> reported;
+    for(auto& p: paths){
+        for(auto& service: p.services){
+            auto through=GetPathsThrough(service);
+            if(through.size()<2 || !reported.insert(service).second) continue;
+
+            std::cout<<service<<" is shared by";
+            for(auto& name: through) std::cout<<" "<<name;
+            std::cout<<std::endl;
+        }
+    }
+    return !paths.empty();
+}
+
+void ServiceGraph::Run(size_t threadCount)
+{
+    auto start=std::chrono::steady_clock::now();
+    for(auto& async: asyncEdges){
+        async.stage->Start();
+    }
+
+    {
+        ThreadPool pool(std::min(threadCount, sources.size()));
+        for(auto& name: sources){
+            const Node& source=nodes.at(name);
+            pool.Submit([this, &source, &name, start]{
+                if(source.start) source.start();
+                source.subscribe();
+                if(source.stop) source.stop();
+
+                //the queued hops of this source, in the order the paths go through them
+                for(auto& async: asyncEdges){
+                    if(async.source==name) async.stage->Stop();
+                }
+
+                std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-start;
+                std::lock_guard<std::mutex> lock(report_mutex);
+                std::cout<<name<<" exhausted after "<<elapsed.count()<<"s"<<std::endl;
+            });
+        }
+        pool.Wait();
+    }
+
+    std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-start;
+    std::cout<<"all "<<sources.size()<<" sources exhausted after "<<elapsed.count()<<"s"<<std::endl;
+    PrintEdgeMetrics();
+}
+
+const std::vector<std::string>& ServiceGraph::GetSources() const
+{
+    return sources;
+}
+
+std::vector<std::string> ServiceGraph::GetPathsThrough(const std::string &name) const
+{
+    std::vector<std::string> through;
+    for(auto& p: paths){
+        if(std::find(p.services.begin(), p.services.end(), name)!=p.services.end()){
+            through.push_back(p.name);
+        }
+    }
+    return through;
+}
+
+void ServiceGraph::PrintEdgeMetrics() const
+{
+    for(auto& async: asyncEdges){
+        auto metrics=async.stage->GetMetrics();
+        std::cout<<async.from<<" -> "<<async.to<<": "<<metrics<<std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,414 @@
+/**
+ * shmring.hpp
+ * Defines a single-producer/single-consumer ring buffer of fixed-size records in POSIX shared memory (/dev/shm),
+ * the book update record the feed handler writes into it, and the latency statistics of a consumer.
+ *
+ * The producer and the consumer live in different processes. Each side only writes its own index
+ * (head for the producer, tail for the consumer) and keeps a cached copy of the other one, so the
+ * shared cache lines are only touched when the ring looks full or empty.
+ * Timestamps are taken from std::chrono::steady_clock, which is CLOCK_MONOTONIC on Linux and so
+ * comparable between processes on the same machine.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "binaryformat.h"
+
+using namespace std;
+
+// Name of the ring the feed simulator and MarketDataConnector use by default
+const char SHM_RING_DEFAULT_NAME[] = "/trading_system_marketdata";
+
+// Number of slots of a ring the feed simulator creates by default
+const uint64_t SHM_RING_DEFAULT_CAPACITY = 1 << 16;
+
+const char SHM_RING_MAGIC[8] = {'T', 'S', 'S', 'H', 'M', 'R', 'N', 'G'};
+const uint32_t SHM_RING_VERSION = 2;
+
+/**
+ * One order book update as the feed handler hands it over: 5 levels of bid and offer,
+ * prices in 1/256 ticks, and the time the update was written into the ring.
+ */
+struct BookUpdate
+{
+    char product[PRODUCT_ID_WIDTH];
+    int64_t bidPrice[BOOK_DEPTH];
+    int64_t bidQuantity[BOOK_DEPTH];
+    int64_t offerPrice[BOOK_DEPTH];
+    int64_t offerQuantity[BOOK_DEPTH];
+    uint64_t sequence;
+    int64_t timestamp;      // steady_clock nanoseconds when the update was pushed
+};
+
+/**
+ * Header at the start of the shared memory, each index sits on its own cache line.
+ */
+struct ShmRingHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t slotSize;
+    uint64_t capacity;
+    std::atomic<uint32_t> ready;                // set by the producer once the fields above are written
+    alignas(64) std::atomic<uint64_t> head;     // written by the producer only
+    alignas(64) std::atomic<uint64_t> tail;     // written by the consumer only
+    alignas(64) std::atomic<uint32_t> closed;   // set by the producer after its last record
+};
+
+/**
+ * A ring of records of type T in shared memory.
+ * T must be trivially copyable, it is copied in and out of the slots with memcpy.
+ */
+template<typename T>
+class ShmRing
+{
+
+public:
+
+    // ctor for a ring that is not attached yet
+    ShmRing();
+
+    // dtor unmaps the ring, the shared memory itself stays until Remove is called
+    ~ShmRing();
+
+    // Create the ring as the producer, a stale ring of the same name is replaced, capacity is rounded up to a power of 2
+    bool Create(const std::string &name, uint64_t capacity);
+
+    // Open an existing ring as the consumer, waiting up to timeoutMs for the producer to create it
+    bool Open(const std::string &name, long timeoutMs);
+
+    // Whether the ring is attached
+    bool IsOpen() const;
+
+    // Get the number of slots
+    uint64_t GetCapacity() const;
+
+    // Push a record, return false if the ring is full
+    bool TryPush(const T &record);
+
+    // Pop a record, return false if the ring is empty
+    bool TryPop(T &record);
+
+    // Mark that the producer will not push any more records
+    void Close();
+
+    // Whether the producer has closed the ring
+    bool IsClosed() const;
+
+    // Remove the named ring from /dev/shm
+    static void Remove(const std::string &name);
+
+private:
+
+    // a mapping cannot be copied
+    ShmRing(const ShmRing &) = delete;
+    ShmRing& operator=(const ShmRing &) = delete;
+
+    // Get the size of a ring with the given capacity
+    static size_t MappingSize(uint64_t capacity);
+
+    // Map the ring and point the slots after the header
+    bool Map(int fd, size_t size);
+
+    void* mapping;
+    size_t size;
+    ShmRingHeader* header;
+    T* slots;
+    uint64_t mask;
+    uint64_t cachedHead;    // the consumer's copy of head
+    uint64_t cachedTail;    // the producer's copy of tail
+
+};
+
+/**
+ * Latency samples of a consumer in nanoseconds, summarised when the run is over.
+ */
+class LatencyStats
+{
+
+public:
+
+    // ctor reserving room for the expected number of samples
+    explicit LatencyStats(size_t expected = 0);
+
+    // Clear all samples
+    void Reset();
+
+    // Add one sample
+    void Add(int64_t nanoseconds);
+
+    // Get the number of samples
+    size_t GetCount() const;
+
+    // Get the sample at the given percentile (0 to 100)
+    int64_t GetPercentile(double percentile) const;
+
+    // Get the mean of the samples
+    double GetMean() const;
+
+    // print count, mean and percentiles in microseconds
+    friend ostream& operator << (ostream& os, const LatencyStats& stats){
+        if(stats.samples.empty()){
+            os<<"no latency samples";
+            return os;
+        }
+        os<<stats.GetCount()<<" samples, mean "<<stats.GetMean()/1000.<<"us"
+          <<", p50 "<<stats.GetPercentile(50)/1000.<<"us"
+          <<", p99 "<<stats.GetPercentile(99)/1000.<<"us"
+          <<", p99.9 "<<stats.GetPercentile(99.9)/1000.<<"us"
+          <<", max "<<stats.GetPercentile(100)/1000.<<"us";
+        return os;
+    }
+
+private:
+    mutable std::vector<int64_t> samples;
+    mutable bool sorted;
+
+};
+
+// Get the current steady_clock time in nanoseconds
+int64_t SteadyNanoseconds();
+
+
+
+//define member functions in class: ShmRing
+template<typename T>
+ShmRing<T>::ShmRing() :
+        mapping(nullptr), size(0), header(nullptr), slots(nullptr), mask(0), cachedHead(0), cachedTail(0)
+{
+}
+
+template<typename T>
+ShmRing<T>::~ShmRing()
+{
+    if (mapping) munmap(mapping, size);
+}
+
+template<typename T>
+size_t ShmRing<T>::MappingSize(uint64_t capacity)
+{
+    size_t slotsOffset = (sizeof(ShmRingHeader) + 63) & ~static_cast<size_t>(63);
+    return slotsOffset + capacity * sizeof(T);
+}
+
+template<typename T>
+bool ShmRing<T>::Map(int fd, size_t _size)
+{
+    void* p = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+
+    mapping = p;
+    size = _size;
+    header = static_cast<ShmRingHeader*>(p);
+    slots = reinterpret_cast<T*>(static_cast<char*>(p) + ((sizeof(ShmRingHeader) + 63) & ~static_cast<size_t>(63)));
+    return true;
+}
+
+template<typename T>
+bool ShmRing<T>::Create(const std::string &name, uint64_t capacity)
+{
+    uint64_t slotCount = 1;
+    while (slotCount < capacity) slotCount <<= 1;
+
+    //start from a fresh segment so a consumer of an earlier run never sees its indexes
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return false;
+
+    size_t bytes = MappingSize(slotCount);
+    if (ftruncate(fd, bytes) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    if (!Map(fd, bytes)) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    //the new pages are zero, so the indexes start at 0; ready is stored last to publish the ring
+    new (&header->ready) std::atomic<uint32_t>(0);
+    new (&header->head) std::atomic<uint64_t>(0);
+    new (&header->tail) std::atomic<uint64_t>(0);
+    new (&header->closed) std::atomic<uint32_t>(0);
+    memcpy(header->magic, SHM_RING_MAGIC, sizeof(SHM_RING_MAGIC));
+    header->version = SHM_RING_VERSION;
+    header->slotSize = sizeof(T);
+    header->capacity = slotCount;
+    header->ready.store(1, std::memory_order_release);
+
+    mask = slotCount - 1;
+    cachedHead = cachedTail = 0;
+    return true;
+}
+
+template<typename T>
+bool ShmRing<T>::Open(const std::string &name, long timeoutMs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    while (true) {
+        //wait until the producer has created the segment and written the header
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmRingHeader)) {
+            if (Map(fd, st.st_size)) {
+                //the header fields are only read once ready is seen, and a ring already closed is
+                //left over from an earlier run, so keep waiting for the producer to replace it
+                if (header->ready.load(std::memory_order_acquire) != 0 &&
+                        memcmp(header->magic, SHM_RING_MAGIC, sizeof(SHM_RING_MAGIC)) == 0 &&
+                        header->version == SHM_RING_VERSION && header->slotSize == sizeof(T) &&
+                        MappingSize(header->capacity) <= size &&
+                        header->closed.load(std::memory_order_acquire) == 0) {
+                    mask = header->capacity - 1;
+                    cachedTail = header->tail.load(std::memory_order_relaxed);
+                    cachedHead = header->head.load(std::memory_order_acquire);
+                    return true;
+                }
+                munmap(mapping, size);
+                mapping = nullptr;
+                header = nullptr;
+            }
+        }
+        else if (fd >= 0) {
+            close(fd);
+        }
+
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+template<typename T>
+bool ShmRing<T>::IsOpen() const
+{
+    return header != nullptr;
+}
+
+template<typename T>
+uint64_t ShmRing<T>::GetCapacity() const
+{
+    return mask + 1;
+}
+
+template<typename T>
+bool ShmRing<T>::TryPush(const T &record)
+{
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    if (head - cachedTail > mask) {
+        //only look at the consumer's index when our copy says the ring is full
+        cachedTail = header->tail.load(std::memory_order_acquire);
+        if (head - cachedTail > mask) return false;
+    }
+
+    memcpy(&slots[head & mask], &record, sizeof(T));
+    header->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+bool ShmRing<T>::TryPop(T &record)
+{
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    if (tail == cachedHead) {
+        //only look at the producer's index when our copy says the ring is empty
+        cachedHead = header->head.load(std::memory_order_acquire);
+        if (tail == cachedHead) return false;
+    }
+
+    memcpy(&record, &slots[tail & mask], sizeof(T));
+    header->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+void ShmRing<T>::Close()
+{
+    header->closed.store(1, std::memory_order_release);
+}
+
+template<typename T>
+bool ShmRing<T>::IsClosed() const
+{
+    return header->closed.load(std::memory_order_acquire) != 0;
+}
+
+template<typename T>
+void ShmRing<T>::Remove(const std::string &name)
+{
+    shm_unlink(name.c_str());
+}
+
+
+
+//define member functions in class: LatencyStats
+LatencyStats::LatencyStats(size_t expected) : sorted(true)
+{
+    samples.reserve(expected);
+}
+
+void LatencyStats::Reset()
+{
+    samples.clear();
+    sorted = true;
+}
+
+void LatencyStats::Add(int64_t nanoseconds)
+{
+    samples.push_back(nanoseconds);
+    sorted = false;
+}
+
+size_t LatencyStats::GetCount() const
+{
+    return samples.size();
+}
+
+int64_t LatencyStats::GetPercentile(double percentile) const
+{
+    if (samples.empty()) return 0;
+    if (!sorted) {
+        std::sort(samples.begin(), samples.end());
+        sorted = true;
+    }
+
+    size_t index = static_cast<size_t>(percentile / 100. * (samples.size() - 1) + 0.5);
+    return samples[std::min(index, samples.size() - 1)];
+}
+
+double LatencyStats::GetMean() const
+{
+    if (samples.empty()) return 0;
+    double sum = 0;
+    for (auto s : samples) {
+        sum += s;
+    }
+    return sum / samples.size();
+}
+
+
+
+int64_t SteadyNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
@@ -0,0 +1,178 @@
+/**
+ * snapshot.hpp
+ * Defines an immutable snapshot of an event, shared by handle instead of copied from hop to hop.
+ *
+ * The event is copied once into a heap node that also holds its reference count. Copying a Snapshot
+ * only bumps that count, so a service can hand the same event to all of its listeners, and a queue or
+ * an async stage can keep it, without the Bond's strings, dates or maps being copied again.
+ * The node is freed when the last handle goes away. The count is atomic, so handles may be passed
+ * between threads; the event itself is never written after the snapshot is made.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <atomic>
+#include <utility>
+
+using namespace std;
+
+/**
+ * A shared, read-only handle to an event of type V.
+ */
+template<typename V>
+class Snapshot
+{
+
+public:
+
+    // ctor for an empty handle
+    Snapshot();
+
+    // ctor copying value into a new snapshot
+    explicit Snapshot(const V &value);
+
+    // ctor moving value into a new snapshot
+    explicit Snapshot(V &&value);
+
+    // share the snapshot of other
+    Snapshot(const Snapshot &other);
+
+    // take over the snapshot of other, leaving it empty
+    Snapshot(Snapshot &&other);
+
+    // share the snapshot of other, letting go of our own
+    Snapshot& operator=(Snapshot other);
+
+    // dtor lets go of the snapshot, the last handle frees it
+    ~Snapshot();
+
+    // Get the event
+    const V& operator*() const;
+    const V* operator->() const;
+
+    // Whether the handle holds no snapshot
+    bool IsEmpty() const;
+
+    // Get the number of handles sharing the snapshot
+    long GetRefCount() const;
+
+private:
+
+    // the event and its reference count in one allocation
+    struct Node
+    {
+        std::atomic<long> refs;
+        V value;    // only ever read once the snapshot is made
+
+        explicit Node(const V &_value) : refs(1), value(_value) {}
+        explicit Node(V &&_value) : refs(1), value(std::move(_value)) {}
+    };
+
+    // Let go of the snapshot
+    void Release();
+
+    Node* node;
+
+};
+
+// Get the event behind a batch entry, whether the batch holds events or snapshots of them
+template<typename V>
+const V& SnapshotValue(const V &value);
+
+template<typename V>
+const V& SnapshotValue(const Snapshot<V> &snapshot);
+
+
+
+//define member functions in class: Snapshot
+template<typename V>
+Snapshot<V>::Snapshot() : node(nullptr)
+{
+}
+
+template<typename V>
+Snapshot<V>::Snapshot(const V &value) : node(new Node(value))
+{
+}
+
+template<typename V>
+Snapshot<V>::Snapshot(V &&value) : node(new Node(std::move(value)))
+{
+}
+
+template<typename V>
+Snapshot<V>::Snapshot(const Snapshot &other) : node(other.node)
+{
+    if (node) node->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename V>
+Snapshot<V>::Snapshot(Snapshot &&other) : node(other.node)
+{
+    other.node = nullptr;
+}
+
+template<typename V>
+Snapshot<V>& Snapshot<V>::operator=(Snapshot other)
+{
+    std::swap(node, other.node);
+    return *this;
+}
+
+template<typename V>
+Snapshot<V>::~Snapshot()
+{
+    Release();
+}
+
+template<typename V>
+void Snapshot<V>::Release()
+{
+    //the thread dropping the last handle must see every use of the event before freeing it
+    if (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete node;
+    }
+    node = nullptr;
+}
+
+template<typename V>
+const V& Snapshot<V>::operator*() const
+{
+    return node->value;
+}
+
+template<typename V>
+const V* Snapshot<V>::operator->() const
+{
+    return &node->value;
+}
+
+template<typename V>
+bool Snapshot<V>::IsEmpty() const
+{
+    return node == nullptr;
+}
+
+template<typename V>
+long Snapshot<V>::GetRefCount() const
+{
+    return node ? node->refs.load(std::memory_order_relaxed) : 0;
+}
+
+
+
+template<typename V>
+const V& SnapshotValue(const V &value)
+{
+    return value;
+}
+
+template<typename V>
+const V& SnapshotValue(const Snapshot<V> &snapshot)
+{
+    return *snapshot;
+}
+
+#endif
@@ -9,9 +9,15 @@
 #define SOA_HPP
 
 #include <vector>
+#include <cstddef>
+#include "snapshot.h"
+#include "logger.h"
 
 using namespace std;
 
+// Number of events Connectors hand to a Service at a time unless they are told otherwise
+const size_t DEFAULT_BATCH_SIZE = 1024;
+
 /**
  * Definition of a generic base class ServiceListener to listen to add, update, and remve
  * events on a Service. This listener should be registered on a Service for the Service
@@ -32,6 +38,31 @@ public:
     // Listener callback to process an update event to the Service
     virtual void ProcessUpdate(V &data) = 0;
 
+    // Listener callback to process count add events stored one after another from data.
+    // By default it is one ProcessAdd per event; listeners that can share work across the batch override it.
+    virtual void ProcessAddBatch(V *data, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            ProcessAdd(data[i]);
+        }
+    }
+
+    // Listener callback to process an add event shared as a snapshot, listeners that keep the event keep the handle.
+    // By default it is ProcessAdd on the shared event, which ProcessAdd must only read.
+    virtual void ProcessAddSnapshot(const Snapshot<V> &data)
+    {
+        ProcessAdd(const_cast<V&>(*data));
+    }
+
+    // Listener callback to process count add events shared as snapshots, stored one after another from data.
+    // By default it is one ProcessAddSnapshot per event; listeners that can share work across the batch override it.
+    virtual void ProcessAddSnapshotBatch(const Snapshot<V> *data, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            ProcessAddSnapshot(data[i]);
+        }
+    }
+
 };
 
 /**
@@ -50,6 +81,15 @@ public:
     // The callback that a Connector should invoke for any new or updated data
     virtual void OnMessage(V &data) = 0;
 
+    // The callback that a Connector should invoke for count new or updated data stored one after another from data.
+    // By default it is one OnMessage per event; Services that can share work across the batch override it.
+    virtual void OnMessageBatch(V *data, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            OnMessage(data[i]);
+        }
+    }
+
     // Add a listener to the Service for callbacks on add, remove, and update events
     // for data to the Service.
     virtual void AddListener(ServiceListener<V> *listener) = 0;
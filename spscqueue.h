@@ -0,0 +1,144 @@
+/**
+ * spscqueue.hpp
+ * Defines a bounded single-producer/single-consumer queue between two threads of the same process.
+ * AsyncListener passes events to its worker thread through it, and the Logger passes log records
+ * from each thread to its writer thread.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+using namespace std;
+
+// Number of items a queue holds by default
+const size_t ASYNC_QUEUE_DEFAULT_CAPACITY = 1 << 14;
+
+/**
+ * A bounded queue of T between one producer thread and one consumer thread, without locks.
+ * Like ShmRing, each side only writes its own index and keeps a cached copy of the other one.
+ */
+template<typename T>
+class SpscQueue
+{
+
+public:
+
+    // ctor for a queue of at least capacity slots, rounded up to a power of 2
+    explicit SpscQueue(size_t capacity = ASYNC_QUEUE_DEFAULT_CAPACITY);
+
+    // Get the number of slots
+    size_t GetCapacity() const;
+
+    // Push a copy of item, return false if the queue is full (producer only)
+    bool TryPush(const T &item);
+
+    // Pop the oldest item by moving it out, return false if the queue is empty (consumer only)
+    bool TryPop(T &item);
+
+    // Whether the queue is empty as last seen by either side
+    bool IsEmpty() const;
+
+    // Get the number of items queued now
+    size_t GetDepth() const;
+
+    // Get the most items the consumer has found queued at once
+    size_t GetHighWater() const;
+
+private:
+
+    // a queue cannot be copied
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue& operator=(const SpscQueue &) = delete;
+
+    std::vector<T> slots;
+    uint64_t mask;
+    alignas(64) std::atomic<uint64_t> head;     // written by the producer only
+    uint64_t cachedTail;                        // the producer's copy of tail
+    alignas(64) std::atomic<uint64_t> tail;     // written by the consumer only
+    uint64_t cachedHead;                        // the consumer's copy of head
+    std::atomic<uint64_t> highWater;            // written by the consumer only
+
+};
+
+
+
+//define member functions in class: SpscQueue
+template<typename T>
+SpscQueue<T>::SpscQueue(size_t capacity) :
+        head(0), cachedTail(0), tail(0), cachedHead(0), highWater(0)
+{
+    size_t slotCount = 1;
+    while (slotCount < capacity) slotCount <<= 1;
+    slots.resize(slotCount);
+    mask = slotCount - 1;
+}
+
+template<typename T>
+size_t SpscQueue<T>::GetCapacity() const
+{
+    return mask + 1;
+}
+
+template<typename T>
+bool SpscQueue<T>::TryPush(const T &item)
+{
+    uint64_t h = head.load(std::memory_order_relaxed);
+    if (h - cachedTail > mask) {
+        //only look at the consumer's index when our copy says the queue is full
+        cachedTail = tail.load(std::memory_order_acquire);
+        if (h - cachedTail > mask) return false;
+    }
+
+    slots[h & mask] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+bool SpscQueue<T>::TryPop(T &item)
+{
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    if (t == cachedHead) {
+        //only look at the producer's index when our copy says the queue is empty
+        cachedHead = head.load(std::memory_order_acquire);
+        if (t == cachedHead) return false;
+
+        //the backlog is measured whenever the consumer catches up with the producer's index
+        if (cachedHead - t > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(cachedHead - t, std::memory_order_relaxed);
+        }
+    }
+
+    item = std::move(slots[t & mask]);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+bool SpscQueue<T>::IsEmpty() const
+{
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+template<typename T>
+size_t SpscQueue<T>::GetDepth() const
+{
+    //tail first, so the difference can only overstate the depth, never wrap below zero
+    uint64_t t = tail.load(std::memory_order_acquire);
+    return head.load(std::memory_order_acquire) - t;
+}
+
+template<typename T>
+size_t SpscQueue<T>::GetHighWater() const
+{
+    return highWater.load(std::memory_order_relaxed);
+}
+
+#endif
@@ -27,13 +27,13 @@ public:
     PriceStreamOrder(){};
 
     // ctor for an order
-    PriceStreamOrder(double _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side);
+    PriceStreamOrder(TickPrice _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side);
 
     // The side on this order
     PricingSide GetSide() const;
 
     // Get the price on this order
-    double GetPrice() const;
+    TickPrice GetPrice() const;
 
     // operator overloadding
     friend ostream& operator << (ostream& os, const PriceStreamOrder& t) {
@@ -51,7 +51,7 @@ public:
     long GetHiddenQuantity() const;
 
 private:
-    double price;
+    TickPrice price;
     long visibleQuantity;
     long hiddenQuantity;
     PricingSide side;
@@ -70,7 +70,7 @@ class PriceStream
 public:
 
     //ctor
-    PriceStream(){};
+    PriceStream() : productId(NO_PRODUCT) {};
 
     // ctor
     PriceStream(const T &_product, const PriceStreamOrder &_bidOrder, const PriceStreamOrder &_offerOrder);
@@ -85,7 +85,7 @@ public:
     const PriceStreamOrder& GetOfferOrder() const;
 
 private:
-    T product;
+    ProductId productId;    // the product, interned in ProductTable<T>
     PriceStreamOrder bidOrder;
     PriceStreamOrder offerOrder;
 
@@ -97,7 +97,7 @@ private:
 
 /*************************************************************************************/
 //define member functions in class: PriceStreamOrder
-PriceStreamOrder::PriceStreamOrder(double _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side)
+PriceStreamOrder::PriceStreamOrder(TickPrice _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side)
 {
     price = _price;
     visibleQuantity = _visibleQuantity;
@@ -105,7 +105,7 @@ PriceStreamOrder::PriceStreamOrder(double _price, long _visibleQuantity, long _h
     side = _side;
 }
 
-double PriceStreamOrder::GetPrice() const
+TickPrice PriceStreamOrder::GetPrice() const
 {
     return price;
 }
@@ -125,14 +125,14 @@ long PriceStreamOrder::GetHiddenQuantity() const
 //define member functions in class: PriceStream
 template<typename T>
 PriceStream<T>::PriceStream(const T &_product, const PriceStreamOrder &_bidOrder, const PriceStreamOrder &_offerOrder) :
-        product(_product), bidOrder(_bidOrder), offerOrder(_offerOrder)
+        productId(ProductTable<T>::Generate_Instance()->Intern(_product)), bidOrder(_bidOrder), offerOrder(_offerOrder)
 {
 }
 
 template<typename T>
 const T& PriceStream<T>::GetProduct() const
 {
-    return product;
+    return ProductTable<T>::Generate_Instance()->Get(productId);
 }
 
 template<typename T>
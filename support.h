@@ -11,6 +11,9 @@
 #include <fstream>
 #include <sstream>
 #include "products.h"
+#include "pricetick.h"
+#include "datagenerator.h"
+#include "securitiesmaster.h"
 
 
 //CUSIPS
@@ -22,7 +25,11 @@ const std::string cusip5_year_10 = "9128283F5";
 const std::string cusip6_year_30 = "912810RZ3";
 
 const std::vector<std::string> CUSIPS_CONTAINER = {cusip1_year_2, cusip2_year_3, cusip3_year_5,
-        cusip4_year_7, cusip1_year_2, cusip5_year_10, cusip6_year_30};
+        cusip4_year_7, cusip5_year_10, cusip6_year_30};
+
+//seed and size of the generated prices.txt and marketdata.txt
+const uint64_t GENERATOR_SEED = 9815;
+const long GENERATOR_ROWS_PER_PRODUCT = 1000000;
 
 
 std::vector<float> COUPON_CONTAINER = {
@@ -43,49 +50,66 @@ const std::vector<date> MATURITY_CONTAINER{
         date(2047, 11, 15)
 };
 
-std::vector<Bond> bond_container;
+//write the securities master: the six bonds, then a synthetic bond for every product past them
+bool bond_file(size_t products = CUSIPS_CONTAINER.size(), const std::string &path = SECURITIES_MASTER_FILE) {
+    ofstream os(path);
+    if (!os) return false;
+    os << "CUSIP,Ticker,Coupon,Maturity,IdType,DayCount\n";
+
+    std::vector<std::string> cusips = GeneratorProducts(CUSIPS_CONTAINER, products);
+    for (size_t i = 0; i < cusips.size(); ++i) {
+        float coupon;
+        date maturity;
+        if (i < CUSIPS_CONTAINER.size()) {
+            coupon = COUPON_CONTAINER[i];
+            maturity = MATURITY_CONTAINER[i];
+        }
+        else {
+            //coupons on an eighth of a percent and maturities out to 30 years, drawn from the product's own stream
+            GeneratorRandom random(GENERATOR_SEED, i);
+            coupon = static_cast<float>(0.00125 * (4 + random.Uniform(37)));
+            maturity = date(2018 + random.Uniform(30), 1 + random.Uniform(12), 15);
+        }
+        os << cusips[i] << ",T," << coupon << "," << to_iso_extended_string(maturity) << ",CUSIP,ACT/ACT\n";
+    }
+    return static_cast<bool>(os);
+}
+
 
-void bond_file() {
+//load the securities master once, and give every bond a position and a risk to start from
+void load_bonds(const std::string &path = SECURITIES_MASTER_FILE) {
+    auto securitiesMaster = SecuritiesMaster::Generate_Instance();
+    if (securitiesMaster->IsLoaded()) return;
+    securitiesMaster->Load(path);
 
     // Create a Services to contain data
-    auto bondProductService = BondProductService::Generate_Instance();
     auto bondPositionService = PositionService::Generate_Instance();
     auto bondRiskService = RiskService::Generate_Instance();
 
-    for (int i = 0; i < 6; ++i) {
-        Bond bond(CUSIPS_CONTAINER[i], CUSIP, "T", COUPON_CONTAINER[i], MATURITY_CONTAINER[i]);
+    for (ProductId id : securitiesMaster->GetProductIds()) {
+        const Bond& bond = securitiesMaster->GetBond(id);
         Position<Bond> position(bond);
         PV01<Bond> pv01(bond, rand() % 1 / 100000., position.GetAggregatePosition());
-        bondProductService->AddBond(bond);
-
 
         bondPositionService->Addpos(position);
         bondRiskService->AddRisk(pv01);
-        bond_container.push_back(bond);
     }
 }
 
 
-//define a function for create Bond
-Bond GetBond(std::string cuips){
-    bond_file();
-
-    for(auto it : bond_container){
-        return it;
-    }
+//define a function for get a Bond by its CUSIP, from the securities master
+const Bond& GetBond(std::string cuips){
+    load_bonds();
+    return SecuritiesMaster::Generate_Instance()->GetBond(cuips);
 }
 
 
 
 //Transform price
 auto PriceIndex = [](int num) {
-    //using the same way we define in generate price in trade
-    int num1 = num / 256, num2 = num % 256, num3 = num2 / 8, num4 = num2 % 8;
-    string str1 = std::to_string(99 + num1) + "-", str2 = std::to_string(num3), str3 = std::to_string(num4);
-
-    if (num3 < 10) str2 = "0" + str2;
-    if (num4 == 4)	str3 = "+";
-    return str1 + str2 + str3;
+    //using the same way we define in generate price in trade, num is the number of 1/256 above 99
+    char buffer[PRICE_BUFFER_SIZE];
+    return std::string(buffer, FormatPrice(99 * TICKS_PER_POINT + num, buffer));
 };
 
 
@@ -99,24 +123,8 @@ void trade_file() {
         std::string CUS_IP = CUSIPS_CONTAINER[i - 1];
 
         for (int j = 1; j <= 10; ++j) {
-            //define numbers used to define price
-            int num, num1, num2, num3, num4;
-            std::string str1, str2, str3;
-            num = rand() % (256 * 2 + 1);
-            num1 = num / 256;
-
-            num2 = num % 256;
-            num3 = num2 / 8;
-
-            num4 = num2 % 8;
-
-            str1 = std::to_string(99 + num1) + "-";
-            str2 = std::to_string(num3);
-            str3 = std::to_string(num4);
-
-            //define the decimals
-            if (num4 == 4) str3 = "+";
-            if (num3 < 10) str2 = "0" + str2;
+            //define price
+            int num = rand() % (256 * 2 + 1);
 
             //define quantity, need to cycle between 1000000 to 5000000
             int quantity=0;
@@ -129,7 +137,7 @@ void trade_file() {
 
             //input
             os << CUS_IP << ",T" << (i - 1) * 10 + j << ",TRSY" << 1 + rand() % 3
-               << "," << str1 + str2 + str3 << "," << std::to_string(quantity) << ","
+               << "," << PriceIndex(num) << "," << quantity << ","
                << (rand() % 2 == 1 ? "BUY" : "SELL") << std::endl;
         }
     }
@@ -139,64 +147,14 @@ void trade_file() {
 
 //generate price
 void prices_file() {
-    ofstream os("../input/prices.txt");
-    os << "CUSIP,Mid_Price,Bid/Offer_Spread\n";
-    for (int i = 1; i <= 6; ++i) {
-        std::string CUS_IP = CUSIPS_CONTAINER[i - 1];
-        for (int j = 1; j <= 1000000; ++j){
-            //define mid price
-            int mid_price = rand() % (256 * 2 - 8) + 4;
-
-            //define bid/offer spread
-            int tmp = (rand() % 3 + 2);
-            std::string osc_str = "0-00" + (tmp == 4 ? "+" : std::to_string(tmp));
-            os << CUS_IP << "," << PriceIndex(mid_price) << ',' << osc_str << endl;
-        }
-    }
+    GeneratorConfig config = {CUSIPS_CONTAINER, GENERATOR_ROWS_PER_PRODUCT, GENERATOR_SEED, std::thread::hardware_concurrency()};
+    GeneratePricesFile("../input/prices.txt", config);
 }
 
 
 void market_file() {
-    ofstream os("../input/marketdata.txt");
-    os << "CUSIP,bidprice1,quantity,bidprice2,quantity,bidprice3,quantity,bidprice4,quantity,bidprice5,quantity,offerprice1,quantity,offerprice2,quantity,offerprice3,quantity,offerprice4,quantity,offerprice5,quantity,\n";
-    for (int i = 1; i <= 6; ++i) {
-        std::string CUS_IP = CUSIPS_CONTAINER[i-1];
-        for (int j = 1; j <= 1000000; ++j) {
-            //print cusip
-            os << CUS_IP << ',';
-
-            //define mid_price
-            int mid_price = rand() % (256 * 2 + 1);
-
-
-            //define bid and ask price following the principle that ascend from 1/128 to 1/32 and back to 1/128
-            int bid_price = mid_price - 1;
-            int offer_price = mid_price + 1;
-            for (int k = 1; k <= 5; ++k) {
-                int quantity = 1000000 * k;
-
-                if(k<=4){
-                    os << PriceIndex(bid_price--)<<','<<quantity<<',';
-                }
-                else{
-                    os<< PriceIndex(mid_price - 1)<<','<<quantity<<',';
-                }
-
-
-            }
-            for (int k = 1; k <= 5; ++k) {
-                int quantity = 1000000 * k;
-
-                if(k<=4){
-                    os << PriceIndex(offer_price++)<<','<<quantity<<',';
-                }
-                else{
-                    os << PriceIndex(mid_price + 1)<<','<<quantity<<',';
-                }
-            }
-            os << endl;
-        }
-    }
+    GeneratorConfig config = {CUSIPS_CONTAINER, GENERATOR_ROWS_PER_PRODUCT, GENERATOR_SEED, std::thread::hardware_concurrency()};
+    GenerateMarketDataFile("../input/marketdata.txt", config);
 }
 
 
@@ -206,7 +164,7 @@ void inquiries_file() {
     for (int i = 0; i < 10; ++i) {
         for (int j = 0; j < 6; ++j) {
             // CUSIP_CODE, SIDE, QUANTITY, PRICE, STATE
-            os << CUSIPS_CONTAINER[j] + ',' + (rand() % 2 == 0 ? "BUY" : "SELL") + ',' + "99.35" + ',' + std::to_string(rand() % 100 * i + 125) + ',' + "RECEIVED" << endl;
+            os << CUSIPS_CONTAINER[j] + ',' + (rand() % 2 == 0 ? "BUY" : "SELL") + ',' + std::to_string(rand() % 100 * i + 125) + ',' + PriceIndex(rand() % (256 * 2 + 1)) + ',' + "RECEIVED" << endl;
         }
     }
 }
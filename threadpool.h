@@ -0,0 +1,129 @@
+/**
+ * threadpool.hpp
+ * Defines a fixed pool of worker threads that run submitted tasks, used by the ServiceGraph to drive
+ * every source of the graph at the same time.
+ *
+ * Tasks are coarse (one per source, each reading a whole input), so the pool keeps them in a plain
+ * queue under a mutex rather than anything lock-free.
+ *
+ * @author Sijia Zhang
+ */
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+using namespace std;
+
+/**
+ * A pool of threads taking tasks in the order they were submitted.
+ */
+class ThreadPool
+{
+
+public:
+
+    // ctor starting threadCount workers, at least one
+    explicit ThreadPool(size_t threadCount);
+
+    // dtor waits for every task, then stops the workers
+    ~ThreadPool();
+
+    // Queue a task for the next free worker
+    void Submit(std::function<void()> task);
+
+    // Wait until every task submitted so far has finished
+    void Wait();
+
+    // Get the number of workers
+    size_t GetThreadCount() const;
+
+private:
+
+    // a pool cannot be copied
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool& operator=(const ThreadPool &) = delete;
+
+    // Body of a worker
+    void Run();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    size_t pending;             // tasks submitted and not finished yet
+    bool stopping;
+    std::mutex pool_mutex;
+    std::condition_variable task_ready;
+    std::condition_variable all_done;
+
+};
+
+
+
+//define member functions in class: ThreadPool
+ThreadPool::ThreadPool(size_t threadCount) :
+        pending(0), stopping(false)
+{
+    for (size_t i = 0; i < (threadCount > 0 ? threadCount : 1); ++i) {
+        workers.push_back(std::thread(&ThreadPool::Run, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stopping = true;
+    }
+    task_ready.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        tasks.push(std::move(task));
+        ++pending;
+    }
+    task_ready.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    all_done.wait(lock, [this]{ return pending == 0; });
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+    return workers.size();
+}
+
+void ThreadPool::Run()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            task_ready.wait(lock, [this]{ return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (--pending == 0) all_done.notify_all();
+    }
+}
+
+#endif
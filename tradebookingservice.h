@@ -13,12 +13,27 @@
 #include <map>
 #include <fstream>
 #include <sstream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "soa.h"
+#include "productindexedstore.h"
+#include "pricetick.h"
+#include "csvreader.h"
+#include "messagesocket.h"
 #include "products.h"
 
 // Trade sides
 enum Side { BUY, SELL };
 
+// Parse a side written as BUY or SELL
+ParseResult ParseSide(boost::string_view s, Side &side);
+
 /**
  * Trade object with a price, side, and quantity on a particular book.
  * Type T is the product type.
@@ -30,10 +45,10 @@ class Trade
 public:
 
     //ctor
-    Trade(){};
+    Trade() : productId(NO_PRODUCT) {};
 
     // ctor for a trade
-    Trade(const T &_product, string _tradeId, double _price, string _book, long _quantity, Side _side);
+    Trade(const T &_product, string _tradeId, TickPrice _price, string _book, long _quantity, Side _side);
 
     // Get the product
     const T& GetProduct() const;
@@ -42,7 +57,7 @@ public:
     const string& GetTradeId() const;
 
     // Get the mid price
-    double GetPrice() const;
+    TickPrice GetPrice() const;
 
     // Get the book
     const string& GetBook() const;
@@ -72,9 +87,9 @@ public:
     }
 
 private:
-    T product;
+    ProductId productId;    // the product, interned in ProductTable<T>
     string tradeId;
-    double price;
+    TickPrice price;
     string book;
     long quantity;
     Side side;
@@ -95,8 +110,8 @@ private:
     //define listener
     std::vector<ServiceListener<Trade<Bond>>*> listeners;
 
-    //define a map to find data on the service
-    std::map<std::string, Trade<Bond>> trade_data;
+    //define a store to find data on the service, indexed by product
+    ProductIndexedStore<Trade<Bond>> trade_data;
 
     //ctor
     TradeBookingService(){};
@@ -113,6 +128,9 @@ public:
     // Book the trade
     void BookTrade(Trade<Bond> &trade);
 
+    // Store the trade without notifying listeners, return the trade to pass on
+    Trade<Bond>& ApplyTrade(Trade<Bond> &data);
+
     // pure virtual member functions in class Service.
     // Get data on our service given a key
     Trade<Bond>& GetData(std::string key) ;
@@ -120,6 +138,10 @@ public:
     // The callback that a Connector should invoke for any new or updated data
     void OnMessage(Trade<Bond> &data) ;
 
+    // The callback that a Connector should invoke for a batch of new or updated data,
+    // the whole batch is stored and then handed to each listener at once
+    void OnMessageBatch(Trade<Bond> *data, size_t count) ;
+
     // Add a listener to the Service for callbacks on add, remove, and update events
     // for data to the Service.
     void AddListener(ServiceListener<Trade<Bond>> *listener) ;
@@ -143,12 +165,33 @@ private:
     TradeBookingService* trade_book_service;
     BondProductService* bond_product_service;
 
+    //set by StopFollow and cleared only by StartFollow, so a stop that comes before SubscribeFollow starts is not lost
+    std::atomic<bool> stop_follow;
+
+    //lines read and skipped in the last file subscribed
+    ParseStats stats;
+
+    //trades read but not passed to TradeBookingService yet, and how many to collect before passing them
+    std::vector<Trade<Bond>> batch;
+    size_t batch_size;
+
     // ctor
     TradeBookingConnector(){
         trade_book_service=TradeBookingService::Generate_Instance();
         bond_product_service=BondProductService::Generate_Instance();
+        stop_follow=false;
+        batch_size=DEFAULT_BATCH_SIZE;
     }
 
+    // Queue the trade held in one line of trades.txt, return why the line was skipped if it was
+    ParseErrc BookLine(boost::string_view line);
+
+    // Queue a trade, the batch is passed on once it holds batch_size trades
+    void BookTrade(const Trade<Bond> &trade);
+
+    // Pass the queued trades to TradeBookingService
+    void FlushBatch();
+
 public:
 
     // Generate Instance
@@ -165,6 +208,33 @@ public:
     // It is used for reading data from file via OnMessage Method
     void Subscribe();
 
+    // SubscribeFollow
+    // It is used for reading data from file via OnMessage Method and then keeps following the file,
+    // booking every trade appended to it as soon as it is written, until StopFollow is called
+    void SubscribeFollow(const std::string &path = "../input/trades.txt");
+
+    // Stop a running SubscribeFollow, it returns after handling the lines already read
+    // The stop stays until StartFollow, so a SubscribeFollow that has not started yet returns at once
+    void StopFollow();
+
+    // Allow SubscribeFollow to run again after StopFollow, call it before starting the thread that follows
+    void StartFollow();
+
+    // SubscribeSocket
+    // It is used for reading trades pushed as TRADE_MESSAGEs over a Unix domain socket (see messagesocket.h).
+    // It waits for one sender, passes the trades of every read to OnMessageBatch and returns when the sender closes
+    void SubscribeSocket(const std::string &path = TRADE_SOCKET_PATH);
+
+    // Get the counts of lines read and skipped in the last file subscribed
+    // While SubscribeFollow runs they are only safe to read after StopFollow
+    const ParseStats& GetParseStats() const;
+
+    // Set how many trades are passed to TradeBookingService at a time, 1 passes every trade on its own
+    void SetBatchSize(size_t size);
+
+    // Get how many trades are passed to TradeBookingService at a time
+    size_t GetBatchSize() const;
+
     // GetService
     TradeBookingService* GetService();
 
@@ -172,8 +242,8 @@ public:
 
 //define constructor and member functions in class: Trade
 template<typename T>
-Trade<T>::Trade(const T &_product, string _tradeId, double _price, string _book, long _quantity, Side _side) :
-        product(_product)
+Trade<T>::Trade(const T &_product, string _tradeId, TickPrice _price, string _book, long _quantity, Side _side) :
+        productId(ProductTable<T>::Generate_Instance()->Intern(_product))
 {
     tradeId = _tradeId;
     price = _price;
@@ -185,7 +255,7 @@ Trade<T>::Trade(const T &_product, string _tradeId, double _price, string _book,
 template<typename T>
 const T& Trade<T>::GetProduct() const
 {
-    return product;
+    return ProductTable<T>::Generate_Instance()->Get(productId);
 }
 
 template<typename T>
@@ -195,7 +265,7 @@ const string& Trade<T>::GetTradeId() const
 }
 
 template<typename T>
-double Trade<T>::GetPrice() const
+TickPrice Trade<T>::GetPrice() const
 {
     return price;
 }
@@ -219,11 +289,27 @@ Side Trade<T>::GetSide() const
 }
 
 
+ParseResult ParseSide(boost::string_view s, Side &side)
+{
+    if(s.empty()) return ParseResult{s.data(), PARSE_EMPTY_FIELD};
+    if(s=="BUY"){
+        side=BUY;
+    }
+    else if(s=="SELL"){
+        side=SELL;
+    }
+    else{
+        return ParseResult{s.data(), PARSE_UNKNOWN_VALUE};
+    }
+    return ParseResult{s.data()+s.size(), PARSE_OK};
+}
+
+
 //define member functions in class: TradeBookingService
 void TradeBookingService::BookTrade(Trade<Bond> &trade)
 {
     //BookTrade is used for passing the trade data to the listener.
-    std::cout<<"data goes from TradeBookingService -> listener."<<std::endl;
+    LOG_TRACE("data goes from TradeBookingService -> listener.");
     for(auto& l:listeners){
         l->ProcessAdd(trade);
     }
@@ -232,19 +318,39 @@ void TradeBookingService::BookTrade(Trade<Bond> &trade)
 Trade<Bond>& TradeBookingService::GetData(std::string key)
 {
     //get data given a key
-    return trade_data.at(key);
+    return trade_data.At(key);
+}
+
+Trade<Bond>& TradeBookingService::ApplyTrade(Trade<Bond> &data)
+{
+    //store the newly or updated data
+    trade_data.Insert(data.GetProduct().GetId(),data);
+    return data;
 }
 
 void TradeBookingService::OnMessage(Trade<Bond> &data) 
 {
     //firstly, store the newly or updated data
-    auto key=data.GetProduct().GetProductId(); //get key
-    trade_data.insert(std::make_pair(key,data));
+    ApplyTrade(data);
 
     //then, pass the updated data to listener
     BookTrade(data);
 }
 
+void TradeBookingService::OnMessageBatch(Trade<Bond> *data, size_t count)
+{
+    //firstly, store the whole batch
+    for(size_t i=0;i<count;++i){
+        ApplyTrade(data[i]);
+    }
+
+    //then, pass the batch to listener
+    LOG_TRACE("data goes from TradeBookingService -> listener. (%lu trades)", count);
+    for(auto& l:listeners){
+        l->ProcessAddBatch(data, count);
+    }
+}
+
 void TradeBookingService::AddListener(ServiceListener<Trade<Bond>> *listener) 
 {
     //add a listener to the service
@@ -264,76 +370,242 @@ void TradeBookingConnector::Publish(Trade<Bond> &data)
     //no implementation inside of this function
 }
 
+ParseErrc TradeBookingConnector::BookLine(boost::string_view line)
+{
+    //split the line into CUSIP, trade id, book, price, quantity and side
+    boost::string_view container[6];
+    CsvLineReader reader(line.data(), line.data()+line.size());
+    reader.NextLine();
+    if(reader.Split(container, 6)<6){
+        return PARSE_MISSING_FIELDS;
+    }
+    if(container[0].empty() || container[1].empty()){
+        return PARSE_EMPTY_FIELD;
+    }
+
+    //parse the numbers and the side, the first bad field decides why the line is skipped
+    int64_t price=0;
+    long quantity=0;
+    Side side=BUY;
+    ParseResult r=ParsePriceTicks(container[3], price);
+    if(r.ec==PARSE_OK) r=ParseLong(container[4], quantity);
+    if(r.ec==PARSE_OK) r=ParseSide(container[5], side);
+    if(r.ec!=PARSE_OK){
+        return r.ec;
+    }
+
+    //define trade
+    //find the bond in order to define trade
+    const Bond& bond=bond_product_service->GetData(std::string(container[0].data(), container[0].size()));
+    Trade<Bond> trade(bond, std::string(container[1].data(), container[1].size()), TickPrice(price),
+                      std::string(container[2].data(), container[2].size()), quantity, side);
+
+    //queue it for TradeBookingService
+    BookTrade(trade);
+    return PARSE_OK;
+}
+
+void TradeBookingConnector::BookTrade(const Trade<Bond> &trade)
+{
+    batch.push_back(trade);
+    if(batch.size()>=batch_size){
+        FlushBatch();
+    }
+}
+
+void TradeBookingConnector::FlushBatch()
+{
+    //using OnMessageBatch to pass the data to TradeBookingService
+    if(!batch.empty()){
+        trade_book_service->OnMessageBatch(batch.data(), batch.size());
+        batch.clear();
+    }
+}
+
 void TradeBookingConnector::Subscribe()
 {
-    //define some strings we will use later
-    std::string key, tradeid, book, price, quantity, side;
+    //map the file and do subscribing
+    stats=ParseStats("input/trades.txt");
+    MappedFile file("../input/trades.txt");
+    if(!file.IsOpen()){
+        std::cout<<"input/trades.txt cannot be opened!"<<std::endl;
+        return;
+    }
 
-    //lambda function working to split one line and return vector of parts
-    auto splitoneline = [](std::string line){
-        stringstream ss(line);
-        std::string part; //define each part in the line
-        std::vector<std::string> container; //define container to contain each part and return it
+    CsvLineReader reader(file.Begin(), file.End());
+    reader.NextLine(); //skip the header
 
-        while(getline(ss,part,',')){
-            container.push_back(part); //using comma as our separate signal
+    //book every line, bad lines are skipped and counted
+    while(reader.NextLine()){
+        if(!reader.GetLine().empty()){
+            stats.CountLine(BookLine(reader.GetLine()));
         }
+    }
+    FlushBatch();
 
-        return container;
-    };
+    std::cout<<stats<<std::endl;
+    std::cout<<"input/trade.txt -> TradeBookingService DONE!"<<std::endl;
+}
 
-    //lambda function working to transposing price of the bond
-    auto PriceTranspose = [](std::string& s){
-        size_t pos=s.find_first_of('-'); //position of the '-'
+void TradeBookingConnector::SubscribeFollow(const std::string &path)
+{
+    //StopFollow may have been called before this thread got here
+    if(stop_follow){
+        std::cout<<path<<" -> TradeBookingService FOLLOW STOPPED!"<<std::endl;
+        return;
+    }
 
-        //we use std::stoi to transpose string to double
-        //firstly, calculate the value of the first part before pos '-'
-        double value=std::stoi(s.substr(0,pos));
+    int fd=open(path.c_str(), O_RDONLY);
+    if(fd<0){
+        std::cout<<path<<" cannot be opened!"<<std::endl;
+        return;
+    }
 
-        //then, calculate the first value after '-', 2 char in the string
-        int temp1=std::stoi(s.substr(pos+1,2));
+    //inotify wakes us up as soon as the file is written, without it we fall back to polling the size
+    int notify=inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(notify>=0 && inotify_add_watch(notify, path.c_str(), IN_MODIFY)<0){
+        close(notify);
+        notify=-1;
+    }
+
+    //offset is how far we have read, pending holds a line whose end has not been written yet
+    off_t offset=0;
+    bool header=true;
+    std::string pending;
+    char block[1<<16];
+    stats=ParseStats(path);
+
+    while(!stop_follow){
+        //a file that shrank has been truncated or rewritten, so start again from the top
+        struct stat st;
+        if(fstat(fd, &st)==0 && st.st_size<offset){
+            offset=0;
+            header=true;
+            pending.clear();
+        }
 
-        //at the same time, calculate the last value in s
-        auto last=s[s.size()-1];
-        if(last=='+'){
-            last='4';
+        //read everything appended since the last time
+        ssize_t n;
+        while((n=pread(fd, block, sizeof(block), offset))>0){
+            offset+=n;
+            pending.append(block, n);
+        }
+
+        //book every complete line, keep the unfinished one for later
+        size_t start=0, eol;
+        while((eol=pending.find('\n', start))!=std::string::npos){
+            boost::string_view line(pending.data()+start, eol-start);
+            if(!line.empty() && line.back()=='\r'){
+                line.remove_suffix(1);
+            }
+            if(header){
+                header=false;
+            }
+            else if(!line.empty()){
+                stats.CountLine(BookLine(line));
+            }
+            start=eol+1;
+        }
+        pending.erase(0, start);
+
+        //book what has been read so far instead of waiting for a full batch
+        FlushBatch();
+
+        //wait for the next write
+        if(notify>=0){
+            struct pollfd pfd={notify, POLLIN, 0};
+            if(poll(&pfd, 1, 100)>0){
+                char events[4096];
+                while(read(notify, events, sizeof(events))>0){
+                }
+            }
+        }
+        else{
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
         }
-        int temp2=last-'0';
-
-        //finally, add them up and get the final value
-        value+=(temp1* 8 + temp2) /256.;
-        return value;
-    };
-
-    //read the file and do subscribing
-    ifstream iss("../input/trades.txt");
-    std::string line;
-    getline(iss,line);
-
-    //if the file is not empty
-    while(getline(iss, line)){
-
-        //create a vector to contain the parts in each line
-        std::vector<std::string> container=splitoneline(line);
-
-        //using the string defined above as the name of different parts
-        key=container[0];
-        tradeid=container[1];
-        book=container[2];
-        price=container[3];
-        quantity=container[4];
-        side=container[5];
-
-        //define trade
-        //find the bond in order to define trade
-        auto bond=bond_product_service->GetData(key);
-        Trade<Bond> trade(bond, tradeid, PriceTranspose(price), book, std::stol(quantity), (side=="BUY" ? BUY :SELL));
-
-        //using OnMessage to pass the data to TradeBookingService
-        trade_book_service->OnMessage(trade);
     }
 
-    std::cout<<"input/trade.txt -> TradeBookingService DONE!"<<std::endl;
+    if(notify>=0) close(notify);
+    close(fd);
+
+    std::cout<<stats<<std::endl;
+    std::cout<<path<<" -> TradeBookingService FOLLOW STOPPED!"<<std::endl;
+}
+
+void TradeBookingConnector::StopFollow()
+{
+    stop_follow=true;
+}
+
+void TradeBookingConnector::StartFollow()
+{
+    stop_follow=false;
+}
+
+void TradeBookingConnector::SubscribeSocket(const std::string &path)
+{
+    MessageSocketReader reader;
+    if(!reader.Listen(path) || !reader.Accept()){
+        std::cout<<path<<" cannot be listened on!"<<std::endl;
+        return;
+    }
+    stats=ParseStats(path);
+
+    MessageHeader header;
+    const char* payload;
+    TradeMessage message;
+
+    while(reader.Drain()){
+        //turn every complete message of this read into a trade, bad messages are skipped and counted
+        while(reader.Next(header, payload)){
+            if(header.type!=TRADE_MESSAGE){
+                stats.CountLine(PARSE_UNKNOWN_VALUE);
+                continue;
+            }
+            if(header.length!=sizeof(TradeMessage)){
+                stats.CountLine(PARSE_MISSING_FIELDS);
+                continue;
+            }
+            memcpy(&message, payload, sizeof(message));
+            if(message.product[0]=='\0' || message.tradeId[0]=='\0'){
+                stats.CountLine(PARSE_EMPTY_FIELD);
+                continue;
+            }
+            if(message.side>SELL || message.price<0){
+                stats.CountLine(PARSE_OUT_OF_RANGE);
+                continue;
+            }
+            stats.CountLine(PARSE_OK);
+
+            //find the bond in order to define trade
+            const Bond& bond=bond_product_service->GetData(GetMessageField(message.product));
+            BookTrade(Trade<Bond>(bond, GetMessageField(message.tradeId), TickPrice(message.price),
+                                  GetMessageField(message.book), message.quantity, static_cast<Side>(message.side)));
+        }
+
+        //book what this read brought in instead of waiting for a full batch
+        FlushBatch();
+    }
+
+    std::cout<<stats<<" in "<<reader.GetDrains()<<" reads"<<std::endl;
+    std::cout<<path<<" -> TradeBookingService DONE!"<<std::endl;
+}
+
+const ParseStats& TradeBookingConnector::GetParseStats() const
+{
+    return stats;
+}
+
+void TradeBookingConnector::SetBatchSize(size_t size)
+{
+    FlushBatch();
+    batch_size=(size>0 ? size : 1);
+    batch.reserve(batch_size);
+}
+
+size_t TradeBookingConnector::GetBatchSize() const
+{
+    return batch_size;
 }
 
 TradeBookingService* TradeBookingConnector::GetService()